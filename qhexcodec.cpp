@@ -0,0 +1,888 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexcodec.h"
+#include "qhexrangereader.h"
+
+#include <QIODevice>
+#include <QString>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <string>
+
+namespace {
+
+enum CharClass : uint8_t {
+	Separator,  // anything which isn't part of a token
+	HexDigit,
+	OtherAlnum, // letters which can't be hex digits, and '_'
+};
+
+struct CharTable {
+	uint8_t classes[256];
+	int8_t values[256]; // value of each hex digit, -1 for everything else
+};
+
+constexpr CharTable make_char_table() {
+	CharTable table = {};
+	for (int i = 0; i < 256; ++i) {
+		table.values[i] = -1;
+		if (i >= '0' && i <= '9') {
+			table.classes[i] = HexDigit;
+			table.values[i]  = static_cast<int8_t>(i - '0');
+		} else if (i >= 'a' && i <= 'f') {
+			table.classes[i] = HexDigit;
+			table.values[i]  = static_cast<int8_t>(i - 'a' + 10);
+		} else if (i >= 'A' && i <= 'F') {
+			table.classes[i] = HexDigit;
+			table.values[i]  = static_cast<int8_t>(i - 'A' + 10);
+		} else if ((i >= 'g' && i <= 'z') || (i >= 'G' && i <= 'Z') || i == '_') {
+			table.classes[i] = OtherAlnum;
+		} else {
+			table.classes[i] = Separator;
+		}
+	}
+	return table;
+}
+
+constexpr CharTable char_table = make_char_table();
+
+inline uint8_t char_class(char ch) {
+	return char_table.classes[static_cast<uint8_t>(ch)];
+}
+
+inline int digit_value(char ch) {
+	return char_table.values[static_cast<uint8_t>(ch)];
+}
+
+/**
+ * @brief hex_prefix
+ * @param p
+ * @param begin the start of the text, p is never before it
+ * @param end
+ * @return true if p starts a 0x or \x prefixed number
+ */
+bool hex_prefix(const char *p, const char *begin, const char *end) {
+	if (end - p < 3 || char_class(p[2]) != HexDigit) {
+		return false;
+	}
+
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		return p == begin || char_class(p[-1]) == Separator;
+	}
+
+	return p[0] == '\\' && p[1] == 'x';
+}
+
+/**
+ * @brief uses_prefixes
+ * @param begin
+ * @param end
+ * @return true if the text has numbers written as 0xNN or \xNN, as in source
+ * code. Only those are taken as data then, so that array lengths and the
+ * like are left out
+ */
+bool uses_prefixes(const char *begin, const char *end) {
+	for (const char *p = begin; (p = static_cast<const char *>(std::memchr(p, 'x', end - p))) != nullptr; ++p) {
+		if (p > begin && hex_prefix(p - 1, begin, end)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief hexdump_line
+ * @param begin
+ * @param end
+ * @return true if the line, without the whitespace around it, is hexdump -C
+ * output: an address of at least 8 digits, two spaces, bytes of two digits
+ * each and then the text between '|'s. The address alone, which the last
+ * line is, counts too
+ */
+bool hexdump_line(const char *begin, const char *end) {
+
+	const char *p = begin;
+	while (p != end && char_class(*p) == HexDigit) {
+		++p;
+	}
+
+	if (p - begin < 8) {
+		return false;
+	}
+
+	if (p == end) {
+		return true;
+	}
+
+	const char *bar = static_cast<const char *>(std::memchr(p, '|', end - p));
+	if (end - p < 2 || p[0] != ' ' || p[1] != ' ' || !bar || bar == end - 1 || end[-1] != '|') {
+		return false;
+	}
+
+	int bytes = 0;
+	for (const char *q = p; q != bar;) {
+		if (*q == ' ') {
+			++q;
+			continue;
+		}
+
+		if (bar - q < 2 || char_class(q[0]) != HexDigit || char_class(q[1]) != HexDigit || (q + 2 != bar && q[2] != ' ')) {
+			return false;
+		}
+
+		q += 2;
+		++bytes;
+	}
+
+	return bytes != 0;
+}
+
+/**
+ * a word copied from a view can look just like a hexdump -C address when the
+ * word after it wasn't selected, so only text which is hexdump -C output
+ * throughout is taken as such
+ *
+ * @brief is_hexdump
+ * @param begin
+ * @param end
+ * @return true if every line of the text is a line of hexdump -C output, a
+ * "*" or empty, and at least one of them has bytes
+ */
+bool is_hexdump(const char *begin, const char *end) {
+
+	bool bytes = false;
+
+	for (const char *line = begin; line < end;) {
+		const char *line_end = static_cast<const char *>(std::memchr(line, '\n', end - line));
+		if (!line_end) {
+			line_end = end;
+		}
+
+		const char *first = line;
+		const char *last  = line_end;
+		while (first != last && std::strchr(" \t\r", *first)) {
+			++first;
+		}
+		while (last != first && std::strchr(" \t\r", last[-1])) {
+			--last;
+		}
+
+		if (first != last && !(last - first == 1 && *first == '*')) {
+			if (!hexdump_line(first, last)) {
+				return false;
+			}
+
+			bytes |= std::memchr(first, '|', last - first) != nullptr;
+		}
+
+		line = (line_end == end) ? end : line_end + 1;
+	}
+
+	return bytes;
+}
+
+/**
+ * @brief parse_address
+ * @param begin
+ * @param end
+ * @param base
+ * @param address receives the address
+ * @return true if the text holds an address, separators between its digits
+ * are skipped and a leading sign is allowed, the way relative addresses are
+ * shown
+ */
+bool parse_address(const char *begin, const char *end, int base, int64_t *address) {
+
+	bool negative = false;
+	bool digits   = false;
+	uint64_t value = 0;
+
+	for (const char *p = begin; p != end; ++p) {
+		const int digit = digit_value(*p);
+		if (digit != -1 && digit < base) {
+			value  = value * base + digit;
+			digits = true;
+		} else if (*p == '-' && !digits) {
+			negative = true;
+		} else if (char_class(*p) != Separator) {
+			return false;
+		}
+	}
+
+	*address = negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+	return digits;
+}
+
+/**
+ * output which grows as needed, written through a pointer so that the
+ * common case of appending a byte is cheap. It never grows past a limit,
+ * which can't be more than a QByteArray can hold
+ */
+class Output {
+public:
+	Output(QByteArray *bytes, int64_t expected, int64_t limit)
+		: bytes_(bytes), limit_(std::min<int64_t>(limit, INT_MAX)) {
+		bytes_->resize(static_cast<int>(std::min(std::max<int64_t>(expected, 16), limit_)));
+	}
+
+	~Output() {
+		bytes_->resize(static_cast<int>(size_));
+	}
+
+	/**
+	 * @brief reserve
+	 * @param n
+	 * @return where to write the next n bytes, commit them once written.
+	 * nullptr if there would be more bytes than the limit
+	 */
+	char *reserve(int64_t n) {
+		if (n > limit_ - size_) {
+			return nullptr;
+		}
+
+		if (size_ + n > bytes_->size()) {
+			bytes_->resize(static_cast<int>(std::min(std::max(size_ + n, static_cast<int64_t>(bytes_->size()) * 2), limit_)));
+		}
+		return bytes_->data() + size_;
+	}
+
+	void commit(int64_t n) { size_ += n; }
+	int64_t size() const { return size_; }
+	int64_t limit() const { return limit_; }
+	const char *data() const { return bytes_->constData(); }
+
+private:
+	QByteArray *bytes_;
+	int64_t limit_;
+	int64_t size_ = 0;
+};
+
+// bytes on each line of the source code formats and each Intel HEX record
+constexpr int BytesPerLine = 16;
+
+// bytes formatted at a time by the raw hex format
+constexpr int RawHexBlock = 4096;
+
+// characters on each line of base64, as written by the base64 tool
+constexpr int Base64LineLength = 76;
+
+constexpr char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * output which is written to a device whenever its buffer fills up, so that
+ * encoding any amount of data takes the same memory
+ */
+class Writer {
+public:
+	explicit Writer(QIODevice *device)
+		: device_(device), buffer_(BufferSize, Qt::Uninitialized) {
+	}
+
+	/**
+	 * @brief reserve
+	 * @param n at most BufferSize
+	 * @return where to write the next n bytes, commit them once written
+	 */
+	char *reserve(int n) {
+		if (used_ + n > BufferSize) {
+			flush();
+		}
+		return buffer_.data() + used_;
+	}
+
+	void commit(int n) {
+		Q_ASSERT(used_ + n <= BufferSize);
+		used_ += n;
+	}
+
+	void write(const char *text, int n) {
+		std::memcpy(reserve(n), text, n);
+		commit(n);
+	}
+
+	void write(const char *text) {
+		write(text, static_cast<int>(std::strlen(text)));
+	}
+
+	void writeByte(uint8_t value) {
+		std::memcpy(reserve(2), &QHexCodec::HexPairs[value * 2], 2);
+		commit(2);
+	}
+
+	/**
+	 * @brief flush
+	 * @return false if the device couldn't take the data, then and from then
+	 * on nothing more is written
+	 */
+	bool flush() {
+		if (!failed_ && used_ != 0 && device_->write(buffer_.constData(), used_) != used_) {
+			failed_ = true;
+		}
+		used_ = 0;
+		return !failed_;
+	}
+
+	bool failed() const { return failed_; }
+
+private:
+	static constexpr int BufferSize = 256 * 1024;
+
+	QIODevice *device_;
+	QByteArray buffer_;
+	int used_    = 0;
+	bool failed_ = false;
+};
+
+/**
+ * writes the body of an array in source code, "0x" before and ", "
+ * between each byte, BytesPerLine bytes to a line
+ *
+ * @brief write_array
+ * @param reader
+ * @param writer
+ * @return false if the data ended early
+ */
+bool write_array(QHexRangeReader &reader, Writer &writer) {
+
+	const int64_t total = reader.size();
+	int64_t index       = 0;
+
+	return reader.forEach([&](const QHexRangeReader::Chunk &chunk) {
+		const auto bytes = reinterpret_cast<const uint8_t *>(chunk.data);
+
+		// the most one byte takes, "    0xff,\n" at the start of a line
+		constexpr int max_item = 10;
+
+		for (int64_t i = 0; i < chunk.size; ++i, ++index) {
+			char *p = writer.reserve(max_item);
+			int n   = 0;
+
+			if (index % BytesPerLine == 0) {
+				std::memcpy(p, "    ", 4);
+				n = 4;
+			}
+
+			p[n++] = '0';
+			p[n++] = 'x';
+			std::memcpy(&p[n], &QHexCodec::HexPairs[bytes[i] * 2], 2);
+			n += 2;
+
+			if (index + 1 != total) {
+				p[n++] = ',';
+			}
+
+			p[n++] = (index % BytesPerLine == BytesPerLine - 1 || index + 1 == total) ? '\n' : ' ';
+			writer.commit(n);
+		}
+
+		return !writer.failed();
+	});
+}
+
+/**
+ * @brief write_python
+ * @param reader
+ * @param writer
+ * @return false if the data ended early
+ */
+bool write_python(QHexRangeReader &reader, Writer &writer) {
+
+	int64_t index = 0;
+
+	const bool complete = reader.forEach([&](const QHexRangeReader::Chunk &chunk) {
+		const auto bytes = reinterpret_cast<const uint8_t *>(chunk.data);
+
+		for (int64_t i = 0; i < chunk.size; ++i, ++index) {
+			if (index % BytesPerLine == 0) {
+				writer.write(index == 0 ? "    b\"" : "\"\n    b\"");
+			}
+
+			char *p = writer.reserve(4);
+			p[0]    = '\\';
+			p[1]    = 'x';
+			std::memcpy(&p[2], &QHexCodec::HexPairs[bytes[i] * 2], 2);
+			writer.commit(4);
+		}
+
+		return !writer.failed();
+	});
+
+	if (index != 0) {
+		writer.write("\"\n");
+	}
+
+	return complete;
+}
+
+/**
+ * @brief write_base64
+ * @param reader
+ * @param writer
+ * @return false if the data ended early
+ */
+bool write_base64(QHexRangeReader &reader, Writer &writer) {
+
+	// bytes left over from the end of a chunk, and how far along the line is
+	uint8_t carry[3];
+	int carried = 0;
+	int column  = 0;
+
+	auto write_group = [&](const uint8_t *in) {
+		char *p = writer.reserve(5);
+		p[0]    = base64_digits[in[0] >> 2];
+		p[1]    = base64_digits[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+		p[2]    = base64_digits[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+		p[3]    = base64_digits[in[2] & 0x3f];
+
+		column += 4;
+		if (column == Base64LineLength) {
+			p[4]   = '\n';
+			column = 0;
+			writer.commit(5);
+		} else {
+			writer.commit(4);
+		}
+	};
+
+	const bool complete = reader.forEach([&](const QHexRangeReader::Chunk &chunk) {
+		const auto bytes = reinterpret_cast<const uint8_t *>(chunk.data);
+		int64_t i        = 0;
+
+		while (carried != 0 && i < chunk.size) {
+			carry[carried++] = bytes[i++];
+			if (carried == 3) {
+				write_group(carry);
+				carried = 0;
+			}
+		}
+
+		for (; i + 3 <= chunk.size; i += 3) {
+			write_group(&bytes[i]);
+		}
+
+		while (i < chunk.size) {
+			carry[carried++] = bytes[i++];
+		}
+
+		return !writer.failed();
+	});
+
+	// one or two bytes at the very end are padded out to four digits
+	if (carried != 0) {
+		const uint8_t b0 = carry[0];
+		const uint8_t b1 = (carried == 2) ? carry[1] : 0;
+
+		char *p = writer.reserve(4);
+		p[0]    = base64_digits[b0 >> 2];
+		p[1]    = base64_digits[((b0 & 0x03) << 4) | (b1 >> 4)];
+		p[2]    = (carried == 2) ? base64_digits[(b1 & 0x0f) << 2] : '=';
+		p[3]    = '=';
+		writer.commit(4);
+		column += 4;
+	}
+
+	if (column != 0) {
+		writer.write("\n");
+	}
+
+	return complete;
+}
+
+/**
+ * Intel HEX, one record for each BytesPerLine bytes which are in a row and
+ * don't cross a 64K boundary, with an extended linear address record before
+ * the first record of each 64K
+ */
+class IntelHexWriter {
+public:
+	explicit IntelHexWriter(Writer *writer)
+		: writer_(writer) {
+	}
+
+	void add(uint64_t address, uint8_t value) {
+
+		if (size_ != 0 && (address != address_ + size_ || size_ == BytesPerLine || (address & 0xffff) == 0)) {
+			flush();
+		}
+
+		if (size_ == 0) {
+			address_ = address;
+
+			if ((address >> 16) != upper_) {
+				upper_                 = address >> 16;
+				const uint8_t upper[2] = {static_cast<uint8_t>(upper_ >> 8), static_cast<uint8_t>(upper_)};
+				record(0x0000, 0x04, upper, 2);
+			}
+		}
+
+		data_[size_++] = value;
+	}
+
+	void finish() {
+		flush();
+		record(0x0000, 0x01, nullptr, 0);
+	}
+
+private:
+	void flush() {
+		if (size_ != 0) {
+			record(static_cast<uint16_t>(address_), 0x00, data_, size_);
+			size_ = 0;
+		}
+	}
+
+	void record(uint16_t address, uint8_t type, const uint8_t *data, int size) {
+
+		uint8_t sum = static_cast<uint8_t>(size + (address >> 8) + address + type);
+
+		writer_->write(":", 1);
+		writer_->writeByte(static_cast<uint8_t>(size));
+		writer_->writeByte(static_cast<uint8_t>(address >> 8));
+		writer_->writeByte(static_cast<uint8_t>(address));
+		writer_->writeByte(type);
+
+		for (int i = 0; i < size; ++i) {
+			writer_->writeByte(data[i]);
+			sum += data[i];
+		}
+
+		writer_->writeByte(static_cast<uint8_t>(-sum));
+		writer_->write("\n", 1);
+	}
+
+private:
+	Writer *writer_;
+	uint64_t address_ = 0;
+	uint64_t upper_   = 0; // the upper 16 bits of the addresses of the records being written
+	uint8_t data_[BytesPerLine];
+	int size_ = 0;
+};
+
+}
+
+/**
+ * writes the bytes of reader to a device in one of the export formats. The
+ * bytes are encoded a chunk at a time into a fixed size buffer, so memory
+ * use doesn't depend on how much there is
+ *
+ * @brief QHexCodec::encode
+ * @param reader
+ * @param format
+ * @param address the address of the first byte of the device being read,
+ * used by the formats which have addresses
+ * @param out
+ * @param error receives a description of the problem if encoding fails
+ * @return true on success
+ */
+bool QHexCodec::encode(QHexRangeReader &reader, ExportFormat format, uint64_t address, QIODevice *out, QString *error) {
+
+	Writer writer(out);
+	bool complete  = true;
+	bool beyond_4g = false; // Intel HEX addresses are 32 bits
+
+	switch (format) {
+	case RawHex:
+		complete = reader.forEach([&](const QHexRangeReader::Chunk &chunk) {
+			const auto bytes = reinterpret_cast<const uint8_t *>(chunk.data);
+			for (int64_t i = 0; i < chunk.size;) {
+				const int n = static_cast<int>(std::min<int64_t>(chunk.size - i, RawHexBlock));
+				char *p     = writer.reserve(n * 2);
+				for (int j = 0; j < n; ++j) {
+					std::memcpy(&p[j * 2], &HexPairs[bytes[i + j] * 2], 2);
+				}
+				writer.commit(n * 2);
+				i += n;
+			}
+			return !writer.failed();
+		});
+		break;
+	case CArray:
+		writer.write(("const uint8_t data[" + std::to_string(reader.size()) + "] = {\n").c_str());
+		complete = write_array(reader, writer);
+		writer.write("};\n");
+		break;
+	case RustArray:
+		writer.write(("let data: [u8; " + std::to_string(reader.size()) + "] = [\n").c_str());
+		complete = write_array(reader, writer);
+		writer.write("];\n");
+		break;
+	case PythonBytes:
+		writer.write("data = (\n");
+		complete = write_python(reader, writer);
+		writer.write(")\n");
+		break;
+	case Base64:
+		complete = write_base64(reader, writer);
+		break;
+	case IntelHex:
+		if (reader.size() != 0) {
+			IntelHexWriter records(&writer);
+			complete = reader.forEach([&](const QHexRangeReader::Chunk &chunk) {
+				if (address + static_cast<uint64_t>(chunk.offset + chunk.size) > Q_UINT64_C(0x100000000)) {
+					beyond_4g = true;
+					return false;
+				}
+
+				const auto bytes = reinterpret_cast<const uint8_t *>(chunk.data);
+				for (int64_t i = 0; i < chunk.size; ++i) {
+					records.add(address + static_cast<uint64_t>(chunk.offset + i), bytes[i]);
+				}
+				return !writer.failed();
+			});
+			records.finish();
+		}
+		break;
+	}
+
+	if (!writer.flush()) {
+		if (error) {
+			*error = out->errorString();
+		}
+		return false;
+	}
+
+	if (beyond_4g) {
+		if (error) {
+			*error = QString("Intel HEX can't hold addresses above 4 GiB");
+		}
+		return false;
+	}
+
+	if (!complete) {
+		if (error) {
+			*error = QString("the data ended early");
+		}
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * decodes hex text back into bytes. Understood are plain hex in any grouping
+ * ("de ad be ef", "deadbeef", "de:ad:be:ef"), source code arrays and strings
+ * ("{0xde, 0xad}", "\xde\xad"), xxd and hexdump -C output, and what
+ * QHexView::mnuCopy produces, including the "*" lines standing in for
+ * repeated rows when there are addresses to tell how many there were. The
+ * address and text columns of dumps are skipped.
+ *
+ * A token of exactly 2 * wordWidth digits is a word and is stored in the
+ * given byte order, so that text copied from a view of words pastes back as
+ * the same bytes. Any other token is a string of bytes in the order written.
+ * Text which holds more than options.maxSize bytes, "*" lines included, is
+ * an error found before any of the bytes past it are stored
+ *
+ * @brief QHexCodec::decodeHex
+ * @param text
+ * @param size
+ * @param options
+ * @param out receives the bytes
+ * @param error receives a description of the problem if the text isn't hex
+ * @return true on success
+ */
+bool QHexCodec::decodeHex(const char *text, int64_t size, const HexOptions &options, QByteArray *out, QString *error) {
+
+	const char *const text_end = text + size;
+	const bool prefixed_only   = uses_prefixes(text, text_end);
+	const bool hexdump         = is_hexdump(text, text_end);
+	const int address_base     = options.decimalAddresses ? 10 : 16;
+	const int word_digits      = 2 * std::max(options.wordWidth, 1);
+
+	Output output(out, size / 2, options.maxSize);
+
+	auto too_big = [&]() {
+		if (error) {
+			*error = QString("the text holds more than %1 bytes").arg(output.limit());
+		}
+		return false;
+	};
+
+	// the previous line, for expanding "*" lines
+	bool repeat                   = false;
+	bool previous_address         = false;
+	int64_t previous_line_address = 0;
+	int64_t previous_start        = 0; // where its bytes are in the output
+	int64_t previous_size         = 0;
+	int64_t address               = 0;
+
+	int line_number = 0;
+
+	for (const char *line = text; line < text_end;) {
+		++line_number;
+
+		const char *line_end = static_cast<const char *>(std::memchr(line, '\n', text_end - line));
+		if (!line_end) {
+			line_end = text_end;
+		}
+
+		const char *next_line = (line_end == text_end) ? text_end : line_end + 1;
+
+		const char *field     = line;
+		const char *field_end = line_end;
+		bool has_address      = false;
+
+		// leading and trailing whitespace, \r included
+		while (field != field_end && std::strchr(" \t\r", *field)) {
+			++field;
+		}
+		while (field_end != field && std::strchr(" \t\r", field_end[-1])) {
+			--field_end;
+		}
+
+		if (field_end - field == 1 && *field == '*') {
+			repeat = true;
+			line   = next_line;
+			continue;
+		}
+
+		const char *bar = static_cast<const char *>(std::memchr(field, '|', field_end - field));
+
+		int digits = 0;
+		while (field + digits != field_end && char_class(field[digits]) == HexDigit) {
+			++digits;
+		}
+
+		if (hexdump) {
+			// hexdump -C, the address is followed by two spaces and the text by
+			// '|', the last line is the address alone
+			has_address = parse_address(field, field + digits, 16, &address);
+			field_end   = bar ? bar : field + digits;
+			field += digits;
+		} else if (bar) {
+			// a QHexView copy, columns are each followed by a '|'
+			if (options.addressColumn) {
+				has_address = parse_address(field, bar, address_base, &address);
+				field       = bar + 1;
+				const char *second = static_cast<const char *>(std::memchr(field, '|', field_end - field));
+				field_end          = second ? second : field_end;
+			} else {
+				field_end = bar;
+			}
+		} else if (field + digits != field_end && field[digits] == ':' && digits >= 4 && field_end - field > digits + 1 && field[digits + 1] == ' ') {
+			// xxd, the address is followed by ": " and the text by two spaces
+			has_address = parse_address(field, field + digits, 16, &address);
+			field += digits + 1;
+
+			const char *p = field;
+			while (p != field_end && *p == ' ') {
+				++p;
+			}
+
+			for (; p + 1 < field_end; ++p) {
+				if (p[0] == ' ' && p[1] == ' ') {
+					field_end = p;
+					break;
+				}
+			}
+		}
+
+		// the rows a "*" stood in for are copies of the row before it, up to
+		// the address of this one
+		if (repeat && has_address && previous_address && previous_size != 0) {
+			int64_t missing = address - (previous_line_address + previous_size);
+			if (missing > output.limit() - output.size()) {
+				return too_big();
+			}
+
+			while (missing > 0) {
+				const int64_t n = std::min(missing, previous_size);
+				char *p         = output.reserve(n);
+				std::memcpy(p, output.data() + previous_start, n);
+				output.commit(n);
+				missing -= n;
+			}
+		}
+
+		repeat = false;
+
+		const int64_t line_start = output.size();
+
+		for (const char *p = field; p < field_end;) {
+
+			if (char_class(*p) == Separator) {
+				++p;
+				continue;
+			}
+
+			const char *token = p;
+			while (p != field_end && char_class(*p) != Separator) {
+				++p;
+			}
+
+			// the digits of the token, without a 0x or \x prefix
+			const char *first     = token;
+			const bool has_prefix = (p - token > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X')) || (p - token > 1 && token[0] == 'x' && token > text && token[-1] == '\\');
+			if (has_prefix) {
+				first += (token[0] == 'x') ? 1 : 2;
+			} else if (prefixed_only) {
+				continue;
+			}
+
+			const int64_t length = p - first;
+
+			bool hex = true;
+			for (const char *q = first; q != p; ++q) {
+				hex &= char_class(*q) == HexDigit;
+			}
+
+			if (!hex || (!has_prefix && length % 2 != 0)) {
+				if (prefixed_only) {
+					continue;
+				}
+
+				if (error) {
+					*error = QString("line %1: '%2' is not a hex byte string").arg(line_number).arg(QString::fromLatin1(token, static_cast<int>(p - token)));
+				}
+				return false;
+			}
+
+			// a prefixed number can have an odd number of digits, the first of
+			// them is then a byte on its own
+			const int64_t bytes = (length + 1) / 2;
+			char *dest          = output.reserve(bytes);
+			if (!dest) {
+				return too_big();
+			}
+
+			const char *q = first;
+			int64_t i     = 0;
+			if (length % 2 != 0) {
+				dest[i++] = static_cast<char>(digit_value(*q++));
+			}
+
+			for (; i < bytes; ++i, q += 2) {
+				dest[i] = static_cast<char>((digit_value(q[0]) << 4) | digit_value(q[1]));
+			}
+
+			if (options.littleEndian && length == word_digits && word_digits > 2) {
+				std::reverse(dest, dest + bytes);
+			}
+
+			output.commit(bytes);
+		}
+
+		previous_address      = has_address;
+		previous_line_address = address;
+		previous_start        = line_start;
+		previous_size         = output.size() - line_start;
+
+		line = next_line;
+	}
+
+	return true;
+}
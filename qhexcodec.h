@@ -0,0 +1,74 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXCODEC_H_
+#define QHEXCODEC_H_
+
+#include <QByteArray>
+#include <climits>
+#include <cstdint>
+
+class QHexRangeReader;
+class QIODevice;
+class QString;
+
+/**
+ * conversions between bytes and the text formats they are pasted and
+ * exported in
+ */
+class QHexCodec {
+public:
+	enum ExportFormat {
+		RawHex,      // deadbeef
+		CArray,      // const uint8_t data[4] = { 0xde, 0xad, 0xbe, 0xef };
+		RustArray,   // let data: [u8; 4] = [ 0xde, 0xad, 0xbe, 0xef ];
+		PythonBytes, // data = ( b"\xde\xad\xbe\xef" )
+		Base64,      // 3q2+7w==, in lines of 76 characters
+		IntelHex     // :04000000DEADBEEFC4, with addresses
+	};
+
+	struct HexOptions {
+		int wordWidth         = 1;       // tokens of exactly 2 * wordWidth digits are words rather than byte strings
+		bool littleEndian     = false;   // byte order of such words
+		bool addressColumn    = false;   // lines containing a '|' start with an address, as copied from a QHexView
+		bool decimalAddresses = false;   // those addresses are in decimal
+		int64_t maxSize       = INT_MAX; // decoding to more bytes than this is an error, it is never more than INT_MAX
+	};
+
+public:
+	// the two hex digits of every byte value, those of b start at 2 * b
+	static constexpr char HexPairs[] = "000102030405060708090a0b0c0d0e0f"
+									   "101112131415161718191a1b1c1d1e1f"
+									   "202122232425262728292a2b2c2d2e2f"
+									   "303132333435363738393a3b3c3d3e3f"
+									   "404142434445464748494a4b4c4d4e4f"
+									   "505152535455565758595a5b5c5d5e5f"
+									   "606162636465666768696a6b6c6d6e6f"
+									   "707172737475767778797a7b7c7d7e7f"
+									   "808182838485868788898a8b8c8d8e8f"
+									   "909192939495969798999a9b9c9d9e9f"
+									   "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+									   "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+									   "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+									   "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+									   "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+									   "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+public:
+	static bool encode(QHexRangeReader &reader, ExportFormat format, uint64_t address, QIODevice *out, QString *error = nullptr);
+	static bool decodeHex(const char *text, int64_t size, const HexOptions &options, QByteArray *out, QString *error = nullptr);
+};
+
+#endif
@@ -0,0 +1,281 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexfilecopy.h"
+#include "qhexrangereader.h"
+#include "qhexsparsefiledevice.h"
+
+#include <QSaveFile>
+#include <QString>
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
+namespace {
+
+// size of the buffer used when the kernel can't copy the data itself
+constexpr int buffered_chunk_size = 4 * 1024 * 1024;
+
+// the most the kernel is asked to copy at once, so that a huge range is not
+// a single uninterruptible call
+constexpr int64_t kernel_chunk_size = Q_INT64_C(1) << 30;
+
+#ifdef Q_OS_LINUX
+
+/**
+ * what is left to try, methods are dropped for good once the kernel or the
+ * filesystems say they don't support them
+ */
+struct KernelCopy {
+	bool clone         = true;
+	bool copyFileRange = true;
+	bool sendfile      = true;
+};
+
+/**
+ * @brief unsupported
+ * @param error an errno value
+ * @return true if the error means that the method can't be used for these
+ * files, rather than that copying failed
+ */
+bool unsupported(int error) {
+	switch (error) {
+	case ENOSYS:
+	case EXDEV:
+	case EINVAL:
+	case EOPNOTSUPP:
+#if ENOTSUP != EOPNOTSUPP
+	case ENOTSUP:
+#endif
+	case EBADF:
+	case ETXTBSY:
+	case EPERM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * copies as much of [offset, offset + size) of in to out at out_offset as
+ * the kernel can
+ *
+ * @brief kernel_copy
+ * @param methods
+ * @param in
+ * @param offset
+ * @param out
+ * @param out_offset
+ * @param size
+ * @param copied receives the number of bytes copied
+ * @return 0 on success, even if not everything was copied, otherwise the
+ * errno of a failure which the rest of the copy should not be attempted after
+ */
+int kernel_copy(KernelCopy *methods, int in, int64_t offset, int out, int64_t out_offset, int64_t size, int64_t *copied) {
+
+	*copied = 0;
+
+#ifdef FICLONERANGE
+	// a reflink shares whole blocks, so only the block aligned part of the
+	// range can be cloned. The rest is copied below
+	if (methods->clone) {
+		struct stat in_stat;
+		struct stat out_stat;
+		if (fstat(in, &in_stat) == 0 && fstat(out, &out_stat) == 0 && out_stat.st_blksize > 0) {
+			const int64_t block = out_stat.st_blksize;
+
+			// a clone may end at the end of the source even if that isn't aligned
+			const bool to_end    = offset + size == in_stat.st_size;
+			const int64_t length = to_end ? size : size / block * block;
+
+			if (offset % block == 0 && out_offset % block == 0 && length != 0) {
+				struct file_clone_range clone;
+				clone.src_fd      = in;
+				clone.src_offset  = static_cast<__u64>(offset);
+				clone.src_length  = static_cast<__u64>(length);
+				clone.dest_offset = static_cast<__u64>(out_offset);
+
+				if (ioctl(out, FICLONERANGE, &clone) == 0) {
+					*copied = length;
+				} else {
+					methods->clone = false;
+				}
+			}
+		}
+	}
+#else
+	methods->clone = false;
+#endif
+
+	while (*copied < size && methods->copyFileRange) {
+		loff_t in_offset = offset + *copied;
+		loff_t to_offset = out_offset + *copied;
+		const ssize_t n  = copy_file_range(in, &in_offset, out, &to_offset, static_cast<size_t>(std::min(size - *copied, kernel_chunk_size)), 0);
+
+		if (n > 0) {
+			*copied += n;
+		} else if (n == 0) {
+			// the source ended early
+			return 0;
+		} else if (errno == EINTR) {
+			continue;
+		} else if (unsupported(errno) && *copied == 0) {
+			methods->copyFileRange = false;
+		} else {
+			return errno;
+		}
+	}
+
+	// sendfile writes at the current position of the destination
+	if (*copied < size && methods->sendfile && lseek(out, out_offset + *copied, SEEK_SET) == -1) {
+		methods->sendfile = false;
+	}
+
+	while (*copied < size && methods->sendfile) {
+		off_t in_offset = offset + *copied;
+		const ssize_t n = sendfile(out, in, &in_offset, static_cast<size_t>(std::min(size - *copied, kernel_chunk_size)));
+
+		if (n > 0) {
+			*copied += n;
+		} else if (n == 0) {
+			return 0;
+		} else if (errno == EINTR) {
+			continue;
+		} else if (unsupported(errno) && *copied == 0) {
+			methods->sendfile = false;
+		} else {
+			return errno;
+		}
+	}
+
+	return 0;
+}
+
+#endif
+
+/**
+ * @brief buffered_copy
+ * @param source
+ * @param range
+ * @param out
+ * @return the number of bytes copied or -1 if writing failed
+ */
+int64_t buffered_copy(QIODevice *source, const QHexSelection::Range &range, QFileDevice *out) {
+
+	int64_t copied = 0;
+
+	QHexRangeReader reader(source, {range}, buffered_chunk_size);
+	const bool complete = reader.forEach([&](const QHexRangeReader::Chunk &chunk) {
+		if (out->write(chunk.data, chunk.size) != chunk.size) {
+			return false;
+		}
+		copied += chunk.size;
+		return true;
+	});
+
+	// running out of data isn't an error, failing to write is
+	return (complete || reader.truncated()) ? copied : -1;
+}
+
+}
+
+/**
+ * writes the ranges of source one after the other to filename, replacing it.
+ * The file is only replaced once everything has been copied, so the source
+ * may be the very file being written
+ *
+ * @brief QHexFileCopy::copy
+ * @param source
+ * @param ranges
+ * @param filename
+ * @param error receives a description of the problem if copying fails
+ * @return true on success
+ */
+bool QHexFileCopy::copy(QIODevice *source, const std::vector<QHexSelection::Range> &ranges, const QString &filename, QString *error) {
+
+	auto fail = [error](const QString &message) {
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+	QSaveFile out(filename);
+	if (!out.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+		return fail(out.errorString());
+	}
+
+#ifdef Q_OS_LINUX
+	KernelCopy methods;
+
+	// a sparse file reads the same as the file behind it, which the kernel
+	// can copy
+	auto sparse = qobject_cast<QHexSparseFileDevice *>(source);
+	auto file   = sparse ? sparse->file() : qobject_cast<QFileDevice *>(source);
+	const int in = file ? file->handle() : -1;
+
+	// anything written through the QFile has to reach the file before the
+	// kernel copies it
+	if (in != -1) {
+		file->flush();
+	}
+#endif
+
+	int64_t written = 0;
+
+	for (const QHexSelection::Range &range : ranges) {
+		const int64_t size = range.end - range.start;
+		int64_t copied     = 0;
+
+#ifdef Q_OS_LINUX
+		if (in != -1) {
+			if (const int result = kernel_copy(&methods, in, range.start, out.handle(), written, size, &copied)) {
+				return fail(QString::fromLocal8Bit(strerror(result)));
+			}
+		}
+#endif
+
+		if (copied < size) {
+			if (!out.seek(written + copied)) {
+				return fail(out.errorString());
+			}
+
+			const int64_t n = buffered_copy(source, QHexSelection::Range{range.start + copied, range.end}, &out);
+			if (n == -1) {
+				return fail(out.errorString());
+			}
+
+			copied += n;
+		}
+
+		written += copied;
+	}
+
+	if (!out.commit()) {
+		return fail(out.errorString());
+	}
+
+	return true;
+}
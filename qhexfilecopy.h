@@ -0,0 +1,37 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXFILECOPY_H_
+#define QHEXFILECOPY_H_
+
+#include "qhexselection.h"
+#include <vector>
+
+class QIODevice;
+class QString;
+
+/**
+ * writes ranges of a device to a file without going through a QByteArray.
+ * When the device is a local file the kernel is asked to do the copying,
+ * first by sharing the blocks (a reflink) where the filesystem can, then with
+ * copy_file_range or sendfile. Whatever the kernel can't do is copied through
+ * one large buffer
+ */
+class QHexFileCopy {
+public:
+	static bool copy(QIODevice *source, const std::vector<QHexSelection::Range> &ranges, const QString &filename, QString *error = nullptr);
+};
+
+#endif
@@ -0,0 +1,686 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexgzipdevice.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileDevice>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QTimer>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <zlib.h>
+
+namespace {
+
+// the largest distance deflate looks back, and so the most a checkpoint has
+// to remember
+constexpr int WindowSize = 32768;
+
+// how much of the file is read at a time
+constexpr int InputSize = 64 * 1024;
+
+constexpr quint32 IndexMagic   = 0x51484758; // "QHGX"
+constexpr quint32 IndexVersion = 1;
+
+}
+
+/**
+ * a zlib inflate stream over part of the file, starting either at the very
+ * beginning or at a checkpoint. Output can be dropped rather than copied
+ * out, in which case the last 32K of it is still remembered, which is what
+ * a checkpoint needs
+ */
+class QHexGzipDevice::Inflater {
+public:
+	enum Status {
+		Ok,
+		End,  // the end of the data, or of as much of it as is there
+		Error // the data is corrupt
+	};
+
+public:
+	explicit Inflater(QIODevice *source)
+		: source_(source), input_(InputSize, Qt::Uninitialized), window_(WindowSize, Qt::Uninitialized) {
+		std::memset(&stream_, 0, sizeof(stream_));
+		stream_.next_in = reinterpret_cast<Bytef *>(input_.data());
+	}
+
+	~Inflater() {
+		if (initialized_) {
+			inflateEnd(&stream_);
+		}
+	}
+
+	Inflater(const Inflater &)            = delete;
+	Inflater &operator=(const Inflater &) = delete;
+
+public:
+	/**
+	 * @brief start
+	 * @return true if inflating can start from the beginning of the file
+	 */
+	bool start() {
+		// 32 lets zlib read the gzip header
+		initialized_ = inflateInit2(&stream_, 15 + 32) == Z_OK;
+		return initialized_;
+	}
+
+	/**
+	 * @brief start
+	 * @param checkpoint
+	 * @return true if inflating can start from the checkpoint
+	 */
+	bool start(const Checkpoint &checkpoint) {
+
+		// checkpoints are in the middle of the deflate data, so there is no
+		// header to read
+		initialized_ = inflateInit2(&stream_, -15) == Z_OK;
+		if (!initialized_) {
+			return false;
+		}
+
+		raw_   = true;
+		out_   = checkpoint.out;
+		start_ = checkpoint.in - (checkpoint.bits ? 1 : 0);
+
+		if (checkpoint.bits) {
+			if (!fill(1)) {
+				return false;
+			}
+
+			inflatePrime(&stream_, checkpoint.bits, *stream_.next_in >> (8 - checkpoint.bits));
+			++stream_.next_in;
+			--stream_.avail_in;
+		}
+
+		if (!checkpoint.window.isEmpty()) {
+			inflateSetDictionary(&stream_, reinterpret_cast<const Bytef *>(checkpoint.window.constData()), static_cast<uInt>(checkpoint.window.size()));
+		}
+
+		return true;
+	}
+
+	/**
+	 * @brief inflate
+	 * @param out
+	 * @param size
+	 * @param stop_at_block return as soon as a deflate block ends, so that a
+	 * checkpoint can be made there
+	 * @param produced receives the number of bytes written to out
+	 * @return
+	 */
+	Status inflate(char *out, int size, bool stop_at_block, int *produced) {
+
+		stream_.next_out  = reinterpret_cast<Bytef *>(out);
+		stream_.avail_out = static_cast<uInt>(size);
+
+		Status status = Ok;
+
+		while (stream_.avail_out != 0) {
+			// a file which stops short is shown up to where it stops
+			if (stream_.avail_in == 0 && !fill(1)) {
+				status = End;
+				break;
+			}
+
+			const int ret = ::inflate(&stream_, Z_BLOCK);
+
+			if (ret == Z_STREAM_END) {
+				if (!nextMember()) {
+					status = End;
+					break;
+				}
+				continue;
+			}
+
+			if (ret != Z_OK) {
+				status = Error;
+				break;
+			}
+
+			if (stop_at_block && atBlockBoundary()) {
+				break;
+			}
+		}
+
+		*produced = size - static_cast<int>(stream_.avail_out);
+		out_ += *produced;
+		return status;
+	}
+
+	/**
+	 * inflates up to size bytes without keeping them, other than the last
+	 * 32K
+	 *
+	 * @brief skip
+	 * @param size
+	 * @param stop_at_block
+	 * @return
+	 */
+	Status skip(int64_t size, bool stop_at_block) {
+
+		int64_t skipped = 0;
+
+		while (skipped < size) {
+			int produced;
+			const Status status = inflate(window_.data() + windowUsed_, static_cast<int>(std::min<int64_t>(size - skipped, WindowSize - windowUsed_)), stop_at_block, &produced);
+
+			windowUsed_ += produced;
+			skipped += produced;
+
+			if (windowUsed_ == WindowSize) {
+				windowUsed_ = 0;
+				windowFull_ = true;
+			}
+
+			if (status != Ok || (stop_at_block && atBlockBoundary())) {
+				return status;
+			}
+		}
+
+		return Ok;
+	}
+
+	/**
+	 * @brief checkpoint
+	 * @return a checkpoint for the current position, which has to be at the
+	 * end of a block, of a stream which has only been skipped through
+	 */
+	Checkpoint checkpoint() const {
+
+		QByteArray window;
+		if (windowFull_) {
+			window = window_.mid(windowUsed_) + window_.left(windowUsed_);
+		} else {
+			window = window_.left(windowUsed_);
+		}
+
+		return Checkpoint{out_, consumed(), stream_.data_type & 7, window};
+	}
+
+public:
+	int64_t out() const { return out_; }
+
+	bool atBlockBoundary() const {
+		// 128 is set at the end of a block or of the header, 64 while in the
+		// last block, after which comes the end of the member
+		return (stream_.data_type & 128) && !(stream_.data_type & 64);
+	}
+
+private:
+	int64_t consumed() const {
+		return start_ + (reinterpret_cast<const char *>(stream_.next_in) - input_.constData());
+	}
+
+	/**
+	 * reads more of the file, unless at least min bytes are already waiting
+	 *
+	 * @brief fill
+	 * @param min
+	 * @return false if the file ends first
+	 */
+	bool fill(uInt min) {
+
+		if (stream_.avail_in >= min) {
+			return true;
+		}
+
+		char *const input = input_.data();
+
+		start_ = consumed();
+		std::memmove(input, stream_.next_in, stream_.avail_in);
+		stream_.next_in = reinterpret_cast<Bytef *>(input);
+
+		while (stream_.avail_in < min) {
+			// the source is shared with every other stream, so it is never
+			// where this one left it
+			if (!source_->seek(start_ + stream_.avail_in)) {
+				return false;
+			}
+
+			const qint64 n = source_->read(input + stream_.avail_in, InputSize - stream_.avail_in);
+			if (n <= 0) {
+				return false;
+			}
+
+			stream_.avail_in += static_cast<uInt>(n);
+		}
+
+		return true;
+	}
+
+	/**
+	 * moves on to the member which follows the one which just ended, if there
+	 * is one
+	 *
+	 * @brief nextMember
+	 * @return false at the end of the file, or if what follows isn't gzip
+	 */
+	bool nextMember() {
+
+		// started from a checkpoint the trailer wasn't expected, it is the
+		// CRC and size of the member
+		if (raw_) {
+			for (uInt trailer = 8; trailer != 0;) {
+				if (!fill(1)) {
+					return false;
+				}
+
+				const uInt n = std::min(trailer, stream_.avail_in);
+				stream_.next_in += n;
+				stream_.avail_in -= n;
+				trailer -= n;
+			}
+		}
+
+		if (!fill(2) || stream_.next_in[0] != 0x1f || stream_.next_in[1] != 0x8b) {
+			return false;
+		}
+
+		raw_ = false;
+		return inflateReset2(&stream_, 15 + 16) == Z_OK;
+	}
+
+private:
+	QIODevice *source_;
+	z_stream stream_;
+	QByteArray input_;
+	QByteArray window_;       // the last 32K skipped, as a ring
+	int windowUsed_   = 0;    // where the next byte goes in window_
+	bool windowFull_  = false;
+	int64_t start_    = 0;    // offset in the file of the start of input_
+	int64_t out_      = 0;    // offset in the decompressed data
+	bool raw_         = false; // started from a checkpoint, so gzip headers aren't being read
+	bool initialized_ = false;
+};
+
+/**
+ * @brief QHexGzipDevice::QHexGzipDevice
+ * @param source the gzip file, which has to stay open for as long as this
+ * does
+ * @param parent
+ */
+QHexGzipDevice::QHexGzipDevice(QIODevice *source, QObject *parent)
+	: QIODevice(parent), source_(source) {
+
+	indexTimer_ = new QTimer(this);
+	connect(indexTimer_, &QTimer::timeout, this, &QHexGzipDevice::indexSlice);
+}
+
+/**
+ * @brief QHexGzipDevice::~QHexGzipDevice
+ */
+QHexGzipDevice::~QHexGzipDevice() = default;
+
+/**
+ * every view of the same gzip file goes through the same device, so that the
+ * file is indexed once and the views share a QHexPageCache
+ *
+ * @brief QHexGzipDevice::forDevice
+ * @param source
+ * @return the open device which reads source decompressed, which is created
+ * if nothing else is using one yet, or nullptr if it can't be opened
+ */
+std::shared_ptr<QHexGzipDevice> QHexGzipDevice::forDevice(QIODevice *source) {
+
+	static QHash<QIODevice *, std::weak_ptr<QHexGzipDevice>> devices;
+
+	if (std::shared_ptr<QHexGzipDevice> device = devices.value(source).lock()) {
+		return device;
+	}
+
+	auto device = std::make_shared<QHexGzipDevice>(source);
+	if (!device->open(QIODevice::ReadOnly)) {
+		return nullptr;
+	}
+
+	// another source may be created at the same address later on
+	if (!devices.contains(source)) {
+		connect(source, &QObject::destroyed, [source]() {
+			devices.remove(source);
+		});
+	}
+
+	devices.insert(source, device);
+	return device;
+}
+
+/**
+ * @brief QHexGzipDevice::isGzip
+ * @param device
+ * @return true if the device starts like a gzip file, the device is left
+ * where it was
+ */
+bool QHexGzipDevice::isGzip(QIODevice *device) {
+	const QByteArray magic = device->peek(2);
+	return magic.size() == 2 && static_cast<uint8_t>(magic[0]) == 0x1f && static_cast<uint8_t>(magic[1]) == 0x8b;
+}
+
+/**
+ * sets how much decompressed data there is between checkpoints. Closer
+ * checkpoints make reads which jump around faster, but each one costs 32K
+ * of memory. Only has an effect before the device is opened
+ *
+ * @brief QHexGzipDevice::setCheckpointSpacing
+ * @param spacing
+ */
+void QHexGzipDevice::setCheckpointSpacing(int64_t spacing) {
+	spacing_ = std::max<int64_t>(spacing, WindowSize);
+}
+
+/**
+ * @brief QHexGzipDevice::indexFileName
+ * @return where the index is saved, or an empty string if the source isn't
+ * a file
+ */
+QString QHexGzipDevice::indexFileName() const {
+	auto file = qobject_cast<QFileDevice *>(source_);
+	if (!file || file->fileName().isEmpty()) {
+		return QString();
+	}
+
+	return file->fileName() + QLatin1String(".qhexindex");
+}
+
+/**
+ * opens the device for reading, with a saved index if there is one which
+ * matches the file, otherwise the first pass is started
+ *
+ * @brief QHexGzipDevice::open
+ * @param mode only reading is supported
+ * @return
+ */
+bool QHexGzipDevice::open(OpenMode mode) {
+
+	if (mode & WriteOnly) {
+		setErrorString(tr("compressed data can't be written"));
+		return false;
+	}
+
+	cursor_.reset();
+
+	if (checkpoints_.empty() && !loadIndex()) {
+		builder_ = std::make_unique<Inflater>(source_);
+		if (!builder_->start()) {
+			builder_.reset();
+			setErrorString(tr("zlib could not be started"));
+			return false;
+		}
+
+		// enough to show something straight away
+		extendIndex(IndexSliceSize);
+	}
+
+	shownSize_ = indexedSize_;
+
+	if (!complete_) {
+		indexTimer_->start(0);
+	}
+
+	return QIODevice::open(mode | Unbuffered);
+}
+
+/**
+ * @brief QHexGzipDevice::close
+ */
+void QHexGzipDevice::close() {
+	indexTimer_->stop();
+	cursor_.reset();
+	QIODevice::close();
+}
+
+/**
+ * @brief QHexGzipDevice::isSequential
+ * @return false, the device can be read at any offset
+ */
+bool QHexGzipDevice::isSequential() const {
+	return false;
+}
+
+/**
+ * @brief QHexGzipDevice::size
+ * @return the size of the decompressed data, or as much of it as the first
+ * pass has got through
+ */
+qint64 QHexGzipDevice::size() const {
+	return indexedSize_;
+}
+
+/**
+ * carries the first pass on until at least size bytes have been inflated,
+ * making checkpoints along the way
+ *
+ * @brief QHexGzipDevice::extendIndex
+ * @param size
+ * @return false if the data turned out to be corrupt
+ */
+bool QHexGzipDevice::extendIndex(int64_t size) {
+
+	while (builder_ && indexedSize_ < size) {
+
+		// checkpoints can only go at the end of a block, so the pass stops at
+		// every one, they are tens of kilobytes apart
+		const Inflater::Status status = builder_->skip(size - indexedSize_, true);
+		indexedSize_                  = builder_->out();
+
+		if (status == Inflater::Ok && builder_->atBlockBoundary() && (checkpoints_.empty() || indexedSize_ - checkpoints_.back().out >= spacing_)) {
+			checkpoints_.push_back(builder_->checkpoint());
+		}
+
+		if (status != Inflater::Ok) {
+			builder_.reset();
+			complete_ = true;
+
+			if (status == Inflater::Error) {
+				setErrorString(tr("the compressed data is corrupt after %1 bytes").arg(static_cast<qlonglong>(indexedSize_)));
+				return false;
+			}
+
+			saveIndex();
+		}
+	}
+
+	return true;
+}
+
+/**
+ * runs one slice of the first pass, called whenever the event loop is idle
+ * until it is done
+ *
+ * @brief QHexGzipDevice::indexSlice
+ */
+void QHexGzipDevice::indexSlice() {
+
+	extendIndex(indexedSize_ + IndexSliceSize);
+
+	if (complete_) {
+		indexTimer_->stop();
+	}
+
+	// reads can move the pass along too, but they don't report it, since
+	// whoever is reading would be told the size changed in the middle of it
+	if (shownSize_ != indexedSize_) {
+		shownSize_ = indexedSize_;
+		Q_EMIT sizeChanged(indexedSize_);
+	}
+}
+
+/**
+ * @brief QHexGzipDevice::readData
+ * @param data
+ * @param maxSize
+ * @return the number of bytes read, or -1 if the data is corrupt
+ */
+qint64 QHexGzipDevice::readData(char *data, qint64 maxSize) {
+
+	const int64_t offset = pos();
+
+	if (!extendIndex(offset + maxSize) && offset + maxSize > indexedSize_) {
+		return -1;
+	}
+
+	const int64_t size = std::min<int64_t>(maxSize, indexedSize_ - offset);
+	if (size <= 0) {
+		return 0;
+	}
+
+	// the nearest checkpoint at or before offset, carrying on from the last
+	// read is better if that ended between the two
+	auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset, [](int64_t offset, const Checkpoint &checkpoint) {
+		return offset < checkpoint.out;
+	});
+
+	const int64_t checkpoint_out = (it == checkpoints_.begin()) ? 0 : std::prev(it)->out;
+
+	if (!cursor_ || cursor_->out() > offset || cursor_->out() < checkpoint_out) {
+		cursor_ = std::make_unique<Inflater>(source_);
+
+		const bool started = (it == checkpoints_.begin()) ? cursor_->start() : cursor_->start(*std::prev(it));
+		if (!started) {
+			cursor_.reset();
+			setErrorString(tr("zlib could not be started"));
+			return -1;
+		}
+	}
+
+	if (cursor_->skip(offset - cursor_->out(), false) == Inflater::Error || cursor_->out() != offset) {
+		cursor_.reset();
+		return -1;
+	}
+
+	qint64 read = 0;
+	while (read < size) {
+		int produced;
+		const Inflater::Status status = cursor_->inflate(data + read, static_cast<int>(std::min<int64_t>(size - read, INT_MAX)), false, &produced);
+		read += produced;
+
+		if (status != Inflater::Ok) {
+			cursor_.reset();
+			break;
+		}
+	}
+
+	return read;
+}
+
+/**
+ * @brief QHexGzipDevice::writeData
+ * @return -1, the device is read only
+ */
+qint64 QHexGzipDevice::writeData(const char *data, qint64 maxSize) {
+	Q_UNUSED(data)
+	Q_UNUSED(maxSize)
+	return -1;
+}
+
+/**
+ * reads the saved index, which is only used if the file is the same size
+ * and was last modified at the same time as when it was saved
+ *
+ * @brief QHexGzipDevice::loadIndex
+ * @return true if an index was loaded
+ */
+bool QHexGzipDevice::loadIndex() {
+
+	const QString filename = indexFileName();
+	if (filename.isEmpty()) {
+		return false;
+	}
+
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	const QFileInfo info(static_cast<QFileDevice *>(source_)->fileName());
+
+	QDataStream stream(&file);
+
+	quint32 magic;
+	quint32 version;
+	qint64 source_size;
+	qint64 modified;
+	qint64 size;
+	quint32 count;
+	stream >> magic >> version >> source_size >> modified >> size >> count;
+
+	if (stream.status() != QDataStream::Ok || magic != IndexMagic || version != IndexVersion || source_size != info.size() || modified != info.lastModified().toMSecsSinceEpoch()) {
+		return false;
+	}
+
+	// a corrupt index can claim any count, but each checkpoint takes at least
+	// its offsets, its bits and the length of its window
+	constexpr int64_t min_checkpoint_size = sizeof(qint64) + sizeof(qint64) + sizeof(qint32) + sizeof(quint32);
+	if (count > (file.size() - file.pos()) / min_checkpoint_size) {
+		return false;
+	}
+
+	std::vector<Checkpoint> checkpoints;
+	checkpoints.reserve(count);
+
+	for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+		qint64 out;
+		qint64 in;
+		qint32 bits;
+		QByteArray window;
+		stream >> out >> in >> bits >> window;
+		checkpoints.push_back(Checkpoint{out, in, bits, window});
+	}
+
+	if (stream.status() != QDataStream::Ok) {
+		return false;
+	}
+
+	checkpoints_ = std::move(checkpoints);
+	indexedSize_ = size;
+	complete_    = true;
+	return true;
+}
+
+/**
+ * saves the finished index next to the file, if the file can be written
+ * next to, a failure to save only means the next open is slower
+ *
+ * @brief QHexGzipDevice::saveIndex
+ */
+void QHexGzipDevice::saveIndex() const {
+
+	const QString filename = indexFileName();
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return;
+	}
+
+	const QFileInfo info(static_cast<QFileDevice *>(source_)->fileName());
+
+	QDataStream stream(&file);
+	stream << IndexMagic << IndexVersion << qint64(info.size()) << qint64(info.lastModified().toMSecsSinceEpoch()) << qint64(indexedSize_) << quint32(checkpoints_.size());
+
+	for (const Checkpoint &checkpoint : checkpoints_) {
+		stream << qint64(checkpoint.out) << qint64(checkpoint.in) << qint32(checkpoint.bits) << checkpoint.window;
+	}
+
+	file.commit();
+}
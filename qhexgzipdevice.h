@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXGZIPDEVICE_H_
+#define QHEXGZIPDEVICE_H_
+
+#include <QByteArray>
+#include <QIODevice>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class QTimer;
+
+/**
+ * the decompressed contents of a gzip file, readable at any offset without
+ * inflating everything before it. While the device is open the file is
+ * inflated once in the background, a slice at a time whenever the event
+ * loop is idle, and every so often the state needed to start inflating
+ * from that point is kept as a checkpoint, in the way zlib's zran example
+ * does. Reads start from the nearest checkpoint at or before them, or carry
+ * on from where the previous read ended. Files made of several gzip members,
+ * such as the output of pigz or bgzip, are read as one stream.
+ *
+ * Until the first pass is done size() is the number of bytes inflated so
+ * far, and grows as it goes, see sizeChanged(). When the source is a file
+ * the finished index is saved next to it, see indexFileName(), so that the
+ * file opens instantly the next time
+ */
+class QHexGzipDevice : public QIODevice {
+	Q_OBJECT
+
+public:
+	static constexpr int64_t DefaultCheckpointSpacing = 4 * 1024 * 1024;
+
+public:
+	explicit QHexGzipDevice(QIODevice *source, QObject *parent = nullptr);
+	~QHexGzipDevice() override;
+
+public:
+	static bool isGzip(QIODevice *device);
+	static std::shared_ptr<QHexGzipDevice> forDevice(QIODevice *source);
+
+public:
+	void setCheckpointSpacing(int64_t spacing);
+	bool isIndexComplete() const { return complete_; }
+	QString indexFileName() const;
+
+public:
+	bool open(OpenMode mode) override;
+	void close() override;
+	bool isSequential() const override;
+	qint64 size() const override;
+
+Q_SIGNALS:
+	void sizeChanged(qint64 size);
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override;
+	qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+	class Inflater;
+
+	// what is needed to start inflating part way through the data
+	struct Checkpoint {
+		int64_t out;       // offset in the decompressed data
+		int64_t in;        // offset of the first whole byte in the file
+		int bits;          // bits of the byte before in which are still to be read
+		QByteArray window; // the decompressed data before out, up to 32K of it
+	};
+
+	bool extendIndex(int64_t size);
+	void indexSlice();
+	bool loadIndex();
+	void saveIndex() const;
+
+private:
+	// how much is inflated by each slice of the background pass
+	static constexpr int64_t IndexSliceSize = 8 * 1024 * 1024;
+
+	QIODevice *source_;
+	int64_t spacing_     = DefaultCheckpointSpacing;
+	int64_t indexedSize_ = 0;     // bytes inflated by the first pass so far
+	int64_t shownSize_   = 0;     // the size last reported by sizeChanged
+	bool complete_       = false; // the first pass has reached the end
+	std::vector<Checkpoint> checkpoints_;
+	std::unique_ptr<Inflater> builder_; // the first pass, carries on where the index ends
+	std::unique_ptr<Inflater> cursor_;  // carries on from where the last read ended
+	QTimer *indexTimer_ = nullptr;
+};
+
+#endif
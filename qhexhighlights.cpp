@@ -0,0 +1,152 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexhighlights.h"
+
+namespace {
+
+/**
+ * @brief normalized
+ * @param highlight
+ * @return the highlight with its start and end swapped if they are reversed
+ */
+QHexHighlights::Highlight normalized(QHexHighlights::Highlight highlight) {
+	if (highlight.start > highlight.end) {
+		std::swap(highlight.start, highlight.end);
+	}
+	return highlight;
+}
+
+}
+
+/**
+ * @brief QHexHighlights::add
+ * @param highlight
+ * @return an id which can be passed to remove
+ */
+int QHexHighlights::add(Highlight highlight) {
+
+	highlight = normalized(std::move(highlight));
+
+	if (!entries_.empty() && highlight.start < entries_.back().highlight.start) {
+		sorted_ = false;
+	}
+
+	indexed_ = false;
+	entries_.push_back(Entry{std::move(highlight), nextId_});
+	return nextId_++;
+}
+
+/**
+ * adds many highlights at once, this is much faster than adding them one at
+ * a time when they are not in order
+ *
+ * @brief QHexHighlights::add
+ * @param highlights
+ * @return the id of the first highlight, the rest have the ids which follow
+ */
+int QHexHighlights::add(std::vector<Highlight> highlights) {
+
+	const int first_id = nextId_;
+
+	entries_.reserve(entries_.size() + highlights.size());
+	for (Highlight &highlight : highlights) {
+		entries_.push_back(Entry{normalized(std::move(highlight)), nextId_++});
+	}
+
+	sorted_  = false;
+	indexed_ = false;
+	return first_id;
+}
+
+/**
+ * @brief QHexHighlights::clear
+ */
+void QHexHighlights::clear() {
+	entries_.clear();
+	maxEnd_.clear();
+	removed_.clear();
+	sorted_  = true;
+	indexed_ = true;
+}
+
+/**
+ * @brief QHexHighlights::remove
+ * @param id an id returned by add
+ */
+void QHexHighlights::remove(int id) {
+	removed_.push_back(id);
+}
+
+/**
+ * applies any pending removals and sorts the entries if needed, after which
+ * the largest end addresses are recomputed
+ *
+ * @brief QHexHighlights::build
+ */
+void QHexHighlights::build() const {
+
+	if (sorted_ && indexed_ && removed_.empty()) {
+		return;
+	}
+
+	if (!removed_.empty()) {
+		std::sort(removed_.begin(), removed_.end());
+
+		entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [this](const Entry &entry) {
+						   return std::binary_search(removed_.begin(), removed_.end(), entry.id);
+					   }),
+					   entries_.end());
+
+		removed_.clear();
+	}
+
+	if (!sorted_) {
+		// ids only ever grow, so ordering by them keeps highlights which start
+		// together in the order they were added
+		std::sort(entries_.begin(), entries_.end(), [](const Entry &lhs, const Entry &rhs) {
+			if (lhs.highlight.start != rhs.highlight.start) {
+				return lhs.highlight.start < rhs.highlight.start;
+			}
+			return lhs.id < rhs.id;
+		});
+
+		sorted_ = true;
+	}
+
+	maxEnd_.resize(entries_.size());
+	buildIndex(0, entries_.size());
+	indexed_ = true;
+}
+
+/**
+ * @brief QHexHighlights::buildIndex
+ * @param first
+ * @param last
+ * @return the largest end address of the subtree made of the entries
+ * [first, last), which is recorded at its middle entry
+ */
+uint64_t QHexHighlights::buildIndex(size_t first, size_t last) const {
+
+	if (first >= last) {
+		return 0;
+	}
+
+	const size_t middle = first + (last - first) / 2;
+
+	const uint64_t max_end = std::max({entries_[middle].highlight.end, buildIndex(first, middle), buildIndex(middle + 1, last)});
+	maxEnd_[middle]        = max_end;
+	return max_end;
+}
@@ -0,0 +1,111 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXHIGHLIGHTS_H_
+#define QHEXHIGHLIGHTS_H_
+
+#include <QColor>
+#include <QString>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * colored, optionally labeled, address ranges drawn behind the data. They are
+ * kept in a flat array sorted by start address, which doubles as an implicit
+ * balanced tree: the middle entry of any span is the parent of the middle
+ * entries of its two halves. Each entry also records the largest end address
+ * in its subtree, so a query skips every subtree which ends before the row,
+ * and the cost depends on how many ranges touch the row rather than on how
+ * many there are. The array is only sorted when it is next queried, so
+ * adding many ranges in a row, in any order, costs a single sort
+ */
+class QHexHighlights {
+public:
+	struct Highlight {
+		uint64_t start; // the addresses [start, end)
+		uint64_t end;
+		QRgb color;
+		QString label;
+	};
+
+public:
+	int add(Highlight highlight);
+	int add(std::vector<Highlight> highlights);
+	void clear();
+	void remove(int id);
+
+public:
+	bool isEmpty() const { return entries_.empty(); }
+
+	/**
+	 * calls func with every highlight which overlaps [start, end), in order of
+	 * their start address. Highlights which start at the same address are
+	 * visited in the order they were added
+	 */
+	template <class Func>
+	void query(uint64_t start, uint64_t end, Func func) const {
+		build();
+		visit(0, entries_.size(), start, end, func);
+	}
+
+private:
+	struct Entry {
+		Highlight highlight;
+		int id;
+	};
+
+	void build() const;
+	uint64_t buildIndex(size_t first, size_t last) const;
+
+	/**
+	 * visits the subtree made of the entries [first, last) in order
+	 */
+	template <class Func>
+	void visit(size_t first, size_t last, uint64_t start, uint64_t end, Func &func) const {
+		while (first < last) {
+			const size_t middle = first + (last - first) / 2;
+
+			// nothing in this subtree reaches start
+			if (maxEnd_[middle] <= start) {
+				return;
+			}
+
+			visit(first, middle, start, end, func);
+
+			// neither this entry nor anything after it starts before end
+			const Highlight &highlight = entries_[middle].highlight;
+			if (highlight.start >= end) {
+				return;
+			}
+
+			if (highlight.end > start) {
+				func(highlight);
+			}
+
+			first = middle + 1;
+		}
+	}
+
+private:
+	mutable std::vector<Entry> entries_;
+	mutable std::vector<uint64_t> maxEnd_; // largest end address in the subtree of each entry
+	mutable std::vector<int> removed_;     // ids which are waiting to be removed by build
+	mutable bool sorted_  = true;
+	mutable bool indexed_ = true;          // maxEnd_ matches entries_
+	int nextId_          = 0;
+};
+
+#endif
@@ -0,0 +1,434 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexpagecache.h"
+
+#include <QIODevice>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+/**
+ * what all of the caches have in common
+ */
+struct Shared {
+	QHash<QIODevice *, std::weak_ptr<QHexPageCache>> devices; // the cache of each device
+	std::vector<QHexPageCache *> caches;                      // every cache which exists
+	int64_t capacity = QHexPageCache::DefaultCapacity;
+	int64_t used     = 0; // bytes held by all of the caches
+	uint64_t clock   = 0; // advances every time a page is used
+};
+
+Shared &shared() {
+	static Shared instance;
+	return instance;
+}
+
+}
+
+/**
+ * @brief QHexPageCache::forDevice
+ * @param device
+ * @return the cache of the device, which is created if nothing else is using
+ * one yet
+ */
+std::shared_ptr<QHexPageCache> QHexPageCache::forDevice(QIODevice *device) {
+
+	Shared &state = shared();
+
+	if (std::shared_ptr<QHexPageCache> cache = state.devices.value(device).lock()) {
+		return cache;
+	}
+
+	std::shared_ptr<QHexPageCache> cache(new QHexPageCache(device));
+	state.devices.insert(device, cache);
+
+	// another device may be created at the same address later on
+	QObject::connect(device, &QObject::destroyed, [device]() {
+		shared().devices.remove(device);
+	});
+
+	return cache;
+}
+
+/**
+ * sets how many bytes all of the caches together may hold
+ *
+ * @brief QHexPageCache::setCapacity
+ * @param capacity
+ */
+void QHexPageCache::setCapacity(int64_t capacity) {
+	shared().capacity = capacity;
+	evict(nullptr);
+}
+
+/**
+ * @brief QHexPageCache::capacity
+ * @return how many bytes all of the caches together may hold
+ */
+int64_t QHexPageCache::capacity() {
+	return shared().capacity;
+}
+
+/**
+ * @brief QHexPageCache::QHexPageCache
+ * @param device
+ */
+QHexPageCache::QHexPageCache(QIODevice *device)
+	: device_(device), prefetchTimer_(std::make_unique<QTimer>()) {
+
+	prefetchTimer_->setInterval(0);
+	QObject::connect(prefetchTimer_.get(), &QTimer::timeout, [this]() {
+		prefetchBatch();
+	});
+
+	// the timer is the context, so this goes away along with the cache
+	QObject::connect(device, &QObject::destroyed, prefetchTimer_.get(), [this]() {
+		prefetch_.clear();
+		prefetchTimer_->stop();
+		invalidate();
+	});
+
+	shared().caches.push_back(this);
+}
+
+/**
+ * @brief QHexPageCache::~QHexPageCache
+ */
+QHexPageCache::~QHexPageCache() {
+	Shared &state = shared();
+
+	state.used -= used_;
+	state.caches.erase(std::remove(state.caches.begin(), state.caches.end(), this), state.caches.end());
+
+	// the entry may already belong to a newer cache for the same device
+	auto it = state.devices.find(device_);
+	if (it != state.devices.end() && it->expired()) {
+		state.devices.erase(it);
+	}
+}
+
+/**
+ * @brief QHexPageCache::size
+ * @return the size of the device, or 0 once it has been destroyed
+ */
+int64_t QHexPageCache::size() const {
+	return device_ ? device_->size() : 0;
+}
+
+/**
+ * copies up to size bytes starting at offset into buffer, reading the pages
+ * they are in if they aren't cached
+ *
+ * @brief QHexPageCache::read
+ * @param offset
+ * @param buffer
+ * @param size
+ * @return the number of bytes copied, which is only less than size at the
+ * end of the device
+ */
+int64_t QHexPageCache::read(int64_t offset, char *buffer, int64_t size) {
+
+	int64_t copied = 0;
+
+	while (copied < size) {
+		const int64_t position = offset + copied;
+		const QByteArray &data = page(position / PageSize);
+		const int start        = static_cast<int>(position % PageSize);
+
+		if (start >= data.size()) {
+			break;
+		}
+
+		const int64_t n = std::min<int64_t>(data.size() - start, size - copied);
+		std::memcpy(buffer + copied, data.constData() + start, n);
+		copied += n;
+
+		if (data.size() < PageSize) {
+			break;
+		}
+	}
+
+	return copied;
+}
+
+/**
+ * drops every page, for when the data behind the device changes
+ *
+ * @brief QHexPageCache::invalidate
+ */
+void QHexPageCache::invalidate() {
+	shared().used -= used_;
+
+	pages_.clear();
+	lookup_.clear();
+	used_ = 0;
+}
+
+/**
+ * drops the pages holding [offset, offset + size), for when only that part
+ * of the data changes, such as the page which was cut short by the end of
+ * data which has since grown
+ *
+ * @brief QHexPageCache::invalidate
+ * @param offset
+ * @param size
+ */
+void QHexPageCache::invalidate(int64_t offset, int64_t size) {
+
+	if (size <= 0) {
+		return;
+	}
+
+	const int64_t first = std::max<int64_t>(offset, 0) / PageSize;
+	const int64_t last  = (offset + size + PageSize - 1) / PageSize;
+
+	auto drop = [this](std::list<Page>::iterator it) {
+		used_ -= it->data.size();
+		shared().used -= it->data.size();
+		lookup_.remove(it->index);
+		return pages_.erase(it);
+	};
+
+	// whichever is fewer, the pages in the range or the pages cached
+	if (last - first > static_cast<int64_t>(pages_.size())) {
+		for (auto it = pages_.begin(); it != pages_.end();) {
+			it = (it->index >= first && it->index < last) ? drop(it) : std::next(it);
+		}
+	} else {
+		for (int64_t index = first; index < last; ++index) {
+			auto it = lookup_.find(index);
+			if (it != lookup_.end()) {
+				drop(*it);
+			}
+		}
+	}
+}
+
+/**
+ * makes sure the pages holding [offset, offset + size) are cached, reading
+ * everything from the first missing one to the last in a single read. Some
+ * devices, such as the memory of another process, are much cheaper to read
+ * in one go than a page at a time
+ *
+ * @brief QHexPageCache::fetch
+ * @param offset
+ * @param size
+ */
+void QHexPageCache::fetch(int64_t offset, int64_t size) {
+
+	const int64_t end   = std::min(offset + size, this->size());
+	const int64_t first = std::max<int64_t>(offset, 0) / PageSize;
+	const int64_t last  = (end + PageSize - 1) / PageSize;
+
+	int64_t missing_first = last;
+	int64_t missing_last  = first;
+	for (int64_t index = first; index < last; ++index) {
+		if (!lookup_.contains(index)) {
+			missing_first = std::min(missing_first, index);
+			missing_last  = index + 1;
+		}
+	}
+
+	if (missing_first < missing_last) {
+		loadRange(missing_first, missing_last);
+	}
+}
+
+/**
+ * asks for the pages holding [offset, offset + size) to be read once the
+ * event loop is idle, so that they are at hand when they are needed. Each
+ * view of the device asks for the data around what it shows
+ *
+ * @brief QHexPageCache::prefetch
+ * @param offset
+ * @param size
+ */
+void QHexPageCache::prefetch(int64_t offset, int64_t size) {
+
+	const int64_t end   = std::min(offset + size, this->size());
+	const int64_t first = std::max<int64_t>(offset, 0) / PageSize;
+	const int64_t last  = (end + PageSize - 1) / PageSize;
+
+	for (int64_t index = first; index < last; ++index) {
+		if (!lookup_.contains(index)) {
+			prefetch_.push_back(index);
+		}
+	}
+
+	while (prefetch_.size() > MaxPrefetchQueue) {
+		prefetch_.pop_front();
+	}
+
+	if (!prefetch_.empty()) {
+		prefetchTimer_->start();
+	}
+}
+
+/**
+ * reads the next few pages which were asked for by prefetch
+ *
+ * @brief QHexPageCache::prefetchBatch
+ */
+void QHexPageCache::prefetchBatch() {
+
+	int loaded = 0;
+
+	// pages which follow each other are read together
+	while (loaded < PrefetchBatch && !prefetch_.empty()) {
+		const int64_t first = prefetch_.front();
+		prefetch_.pop_front();
+
+		if (lookup_.contains(first)) {
+			continue;
+		}
+
+		int64_t last = first + 1;
+		while (loaded + (last - first) < PrefetchBatch && !prefetch_.empty() && prefetch_.front() == last && !lookup_.contains(last)) {
+			prefetch_.pop_front();
+			++last;
+		}
+
+		loadRange(first, last);
+		loaded += static_cast<int>(last - first);
+	}
+
+	if (prefetch_.empty()) {
+		prefetchTimer_->stop();
+	}
+}
+
+/**
+ * @brief QHexPageCache::page
+ * @param index
+ * @return the page, which is now the most recently used one
+ */
+const QByteArray &QHexPageCache::page(int64_t index) {
+
+	auto it = lookup_.find(index);
+	if (it != lookup_.end()) {
+		pages_.splice(pages_.begin(), pages_, *it);
+		pages_.front().used = ++shared().clock;
+	} else {
+		load(index);
+	}
+
+	return pages_.front().data;
+}
+
+/**
+ * reads a page from the device, making it the most recently used one
+ *
+ * @brief QHexPageCache::load
+ * @param index
+ */
+void QHexPageCache::load(int64_t index) {
+	loadRange(index, index + 1);
+}
+
+/**
+ * reads the pages [first, last) from the device with a single read, caching
+ * the ones which aren't already. The last of them becomes the most recently
+ * used page
+ *
+ * @brief QHexPageCache::loadRange
+ * @param first
+ * @param last
+ */
+void QHexPageCache::loadRange(int64_t first, int64_t last) {
+
+	const int64_t size = (last - first) * PageSize;
+
+	QByteArray data(static_cast<int>(size), Qt::Uninitialized);
+
+	int64_t n = -1;
+	if (device_ && device_->seek(first * PageSize)) {
+		n = device_->read(data.data(), size);
+	}
+
+	n = std::max<int64_t>(n, 0);
+
+	Shared &state = shared();
+
+	for (int64_t index = first; index < last; ++index) {
+
+		// a page which is already cached keeps its data, but the last page
+		// has to end up at the front either way
+		auto it = lookup_.find(index);
+		if (it != lookup_.end()) {
+			if (index == last - 1) {
+				pages_.splice(pages_.begin(), pages_, *it);
+				pages_.front().used = ++state.clock;
+			}
+			continue;
+		}
+
+		const int64_t start = (index - first) * PageSize;
+		const int length    = static_cast<int>(std::clamp<int64_t>(n - start, 0, PageSize));
+
+		QByteArray page;
+		if (first + 1 == last) {
+			data.resize(length);
+			page = std::move(data);
+		} else {
+			page = QByteArray(data.constData() + start, length);
+		}
+
+		used_ += page.size();
+		state.used += page.size();
+
+		pages_.push_front(Page{index, ++state.clock, std::move(page)});
+		lookup_.insert(index, pages_.begin());
+	}
+
+	evict(this);
+}
+
+/**
+ * drops the least recently used pages of all of the caches until they fit in
+ * the capacity
+ *
+ * @brief QHexPageCache::evict
+ * @param keep a cache whose most recently used page has to stay, or nullptr
+ */
+void QHexPageCache::evict(const QHexPageCache *keep) {
+
+	Shared &state = shared();
+
+	while (state.used > state.capacity) {
+
+		QHexPageCache *oldest = nullptr;
+		for (QHexPageCache *cache : state.caches) {
+			const size_t minimum = (cache == keep) ? 1 : 0;
+			if (cache->pages_.size() > minimum && (!oldest || cache->pages_.back().used < oldest->pages_.back().used)) {
+				oldest = cache;
+			}
+		}
+
+		if (!oldest) {
+			break;
+		}
+
+		const Page &page = oldest->pages_.back();
+		oldest->used_ -= page.data.size();
+		state.used -= page.data.size();
+		oldest->lookup_.remove(page.index);
+		oldest->pages_.pop_back();
+	}
+}
@@ -0,0 +1,96 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXPAGECACHE_H_
+#define QHEXPAGECACHE_H_
+
+#include <QByteArray>
+#include <QHash>
+#include <QIODevice>
+#include <QPointer>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+
+class QTimer;
+
+/**
+ * fixed size pages of a device which have been read recently, so that
+ * drawing the same rows again, or looking up the records of a table, does not
+ * go back to the device every time. There is one cache per device, shared by
+ * everything which reads it through forDevice(), and all caches together
+ * stay within a single capacity by dropping the least recently used page of
+ * any of them. Nothing notices when the data behind the device changes,
+ * invalidate() has to be called for that. Caches are only meant to be used
+ * from the thread which owns the device
+ */
+class QHexPageCache {
+public:
+	static constexpr int PageSize            = 4096;
+	static constexpr int64_t DefaultCapacity = 16 * 1024 * 1024;
+
+public:
+	static std::shared_ptr<QHexPageCache> forDevice(QIODevice *device);
+	static void setCapacity(int64_t capacity);
+	static int64_t capacity();
+
+public:
+	~QHexPageCache();
+
+private:
+	explicit QHexPageCache(QIODevice *device);
+	Q_DISABLE_COPY(QHexPageCache)
+
+public:
+	int64_t read(int64_t offset, char *buffer, int64_t size);
+	void invalidate();
+	void invalidate(int64_t offset, int64_t size);
+	void fetch(int64_t offset, int64_t size);
+	void prefetch(int64_t offset, int64_t size);
+
+public:
+	QIODevice *device() const { return device_; }
+	int64_t size() const;
+
+private:
+	struct Page {
+		int64_t index;
+		uint64_t used;   // when it was last used, by the clock shared by all caches
+		QByteArray data; // shorter than PageSize at the end of the device
+	};
+
+	// pages read ahead each time the event loop is idle
+	static constexpr int PrefetchBatch = 16;
+
+	// pages waiting to be read ahead, the oldest requests are dropped first
+	static constexpr int MaxPrefetchQueue = 1024;
+
+	const QByteArray &page(int64_t index);
+	void load(int64_t index);
+	void loadRange(int64_t first, int64_t last);
+	void prefetchBatch();
+	static void evict(const QHexPageCache *keep);
+
+private:
+	QPointer<QIODevice> device_; // null once the device is destroyed, anyone may still hold the cache
+	int64_t used_ = 0;                                  // bytes held by pages_
+	std::list<Page> pages_;                             // most recently used first
+	QHash<int64_t, std::list<Page>::iterator> lookup_; // pages_ by index
+	std::deque<int64_t> prefetch_;                      // pages to read ahead, in order
+	std::unique_ptr<QTimer> prefetchTimer_;
+};
+
+#endif
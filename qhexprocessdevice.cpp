@@ -0,0 +1,453 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexprocessdevice.h"
+
+#include <QFile>
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// the most iovecs a single process_vm_readv() takes
+#ifdef IOV_MAX
+constexpr size_t max_iovecs = IOV_MAX;
+#else
+constexpr size_t max_iovecs = 1024;
+#endif
+#endif
+
+/**
+ * @brief page_size
+ * @return the size of a page of memory, the unit in which it is mapped
+ */
+uint64_t page_size() {
+#ifdef Q_OS_LINUX
+	static const uint64_t size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+	return size;
+#else
+	return 4096;
+#endif
+}
+
+/**
+ * parses a line of /proc/<pid>/maps, which looks like
+ * "7f0c2a5e1000-7f0c2a603000 r-xp 00000000 08:01 1234   /usr/lib/libc.so.6"
+ *
+ * @brief parse_region
+ * @param line
+ * @param region
+ * @return true if the line is well formed
+ */
+bool parse_region(const QByteArray &line, QHexProcessDevice::Region *region) {
+
+	uint64_t start;
+	uint64_t end;
+	char permissions[5];
+	int name = -1;
+
+	// the name may contain spaces, so it is everything after the inode
+	if (std::sscanf(line.constData(), "%" SCNx64 "-%" SCNx64 " %4s %*s %*s %*s %n", &start, &end, permissions, &name) < 3 || name == -1 || start >= end) {
+		return false;
+	}
+
+	region->start    = start;
+	region->end      = end;
+	region->readable = permissions[0] == 'r';
+	region->name     = QString::fromLocal8Bit(line.constData() + name);
+	return true;
+}
+
+}
+
+/**
+ * @brief QHexProcessDevice::QHexProcessDevice
+ * @param pid
+ * @param parent
+ */
+QHexProcessDevice::QHexProcessDevice(qint64 pid, QObject *parent)
+	: QHexRegionDevice(parent), pid_(pid) {
+}
+
+/**
+ * @brief QHexProcessDevice::~QHexProcessDevice
+ */
+QHexProcessDevice::~QHexProcessDevice() {
+	close();
+}
+
+/**
+ * reads the mappings of the process again. If no window has been set yet it
+ * becomes the first readable mapping
+ *
+ * @brief QHexProcessDevice::refreshRegions
+ * @param error receives a description of the problem if they can't be read
+ * @return true on success
+ */
+bool QHexProcessDevice::refreshRegions(QString *error) {
+
+	auto fail = [error](const QString &message) {
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+#ifdef Q_OS_LINUX
+	QFile file(QStringLiteral("/proc/%1/maps").arg(pid_));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return fail(file.errorString());
+	}
+
+	// the file has no size, so it can only be read to the end
+	const QByteArray maps = file.readAll();
+
+	std::vector<Region> regions;
+	for (const QByteArray &line : maps.split('\n')) {
+		Region region;
+		if (parse_region(line, &region)) {
+			regions.push_back(std::move(region));
+		}
+	}
+
+	std::sort(regions.begin(), regions.end(), [](const Region &a, const Region &b) {
+		return a.start < b.start;
+	});
+
+	regions_ = std::move(regions);
+
+	// a page which failed to read may be mapped differently now
+	unreadable_.clear();
+
+	if (windowSize_ == 0) {
+		auto it = std::find_if(regions_.begin(), regions_.end(), [](const Region &region) {
+			return region.readable;
+		});
+
+		if (it != regions_.end()) {
+			setWindow(it->start, it->end - it->start);
+		}
+	}
+
+	return true;
+#else
+	return fail(tr("Reading the memory of another process is only supported on Linux"));
+#endif
+}
+
+/**
+ * sets which part of the address space the device covers, offset 0 is at
+ * address
+ *
+ * @brief QHexProcessDevice::setWindow
+ * @param address
+ * @param size
+ */
+void QHexProcessDevice::setWindow(uint64_t address, uint64_t size) {
+	windowStart_ = address;
+	windowSize_  = size;
+}
+
+/**
+ * @brief QHexProcessDevice::regionAfter
+ * @param address
+ * @return the region holding address, or else the first one after it
+ */
+auto QHexProcessDevice::regionAfter(uint64_t address) const -> std::vector<Region>::const_iterator {
+	return std::upper_bound(regions_.begin(), regions_.end(), address, [](uint64_t address, const Region &region) {
+		return address < region.end;
+	});
+}
+
+/**
+ * @brief QHexProcessDevice::holeMask
+ * @param offset
+ * @param size
+ * @param out
+ */
+void QHexProcessDevice::holeMask(int64_t offset, int size, bool *out) const {
+
+	std::fill(out, out + size, true);
+
+	const uint64_t address = windowStart_ + static_cast<uint64_t>(offset);
+	const uint64_t end     = address + static_cast<uint64_t>(size);
+
+	for (auto it = regionAfter(address); it != regions_.end() && it->start < end; ++it) {
+		if (it->readable) {
+			const uint64_t from = std::max(address, it->start);
+			const uint64_t to   = std::min(end, it->end);
+			std::fill(out + (from - address), out + (to - address), false);
+		}
+	}
+
+	if (!unreadable_.isEmpty()) {
+		const uint64_t page = page_size();
+		for (uint64_t start = address & ~(page - 1); start < end; start += page) {
+			if (unreadable_.contains(start)) {
+				const uint64_t from = std::max(address, start);
+				const uint64_t to   = std::min(end, start + page);
+				std::fill(out + (from - address), out + (to - address), true);
+			}
+		}
+	}
+}
+
+/**
+ * @brief QHexProcessDevice::nextData
+ * @param offset
+ * @return the first offset at or after offset which is in a readable
+ * mapping, or size()
+ */
+int64_t QHexProcessDevice::nextData(int64_t offset) const {
+
+	const uint64_t address = windowStart_ + static_cast<uint64_t>(std::max<int64_t>(offset, 0));
+
+	for (auto it = regionAfter(address); it != regions_.end(); ++it) {
+		if (it->readable) {
+			return std::min(static_cast<int64_t>(std::max(address, it->start) - windowStart_), size());
+		}
+	}
+
+	return size();
+}
+
+/**
+ * pages which turned out to be unreadable are not holes here, they are only
+ * found by reading them
+ *
+ * @brief QHexProcessDevice::nextHole
+ * @param offset
+ * @return the first offset at or after offset which isn't in a readable
+ * mapping, or size()
+ */
+int64_t QHexProcessDevice::nextHole(int64_t offset) const {
+
+	const uint64_t address = windowStart_ + static_cast<uint64_t>(std::max<int64_t>(offset, 0));
+
+	auto it = regionAfter(address);
+	if (it == regions_.end() || it->start > address || !it->readable) {
+		return std::min(static_cast<int64_t>(address - windowStart_), size());
+	}
+
+	// mappings often follow on from each other
+	uint64_t end = it->end;
+	for (++it; it != regions_.end() && it->start == end && it->readable; ++it) {
+		end = it->end;
+	}
+
+	return std::min(static_cast<int64_t>(end - windowStart_), size());
+}
+
+/**
+ * @brief QHexProcessDevice::open
+ * @param mode
+ * @return true if the device was opened, it can only be read
+ */
+bool QHexProcessDevice::open(OpenMode mode) {
+	if (mode & WriteOnly) {
+		return false;
+	}
+
+	return QIODevice::open(mode | Unbuffered);
+}
+
+/**
+ * @brief QHexProcessDevice::close
+ */
+void QHexProcessDevice::close() {
+#ifdef Q_OS_LINUX
+	if (memFile_ != -1) {
+		::close(memFile_);
+		memFile_ = -1;
+	}
+#endif
+
+	if (isOpen()) {
+		QIODevice::close();
+	}
+}
+
+/**
+ * @brief QHexProcessDevice::isSequential
+ * @return false, the device can be read at any offset
+ */
+bool QHexProcessDevice::isSequential() const {
+	return false;
+}
+
+/**
+ * @brief QHexProcessDevice::size
+ * @return the size of the window, holes included
+ */
+qint64 QHexProcessDevice::size() const {
+	return static_cast<qint64>(windowSize_);
+}
+
+/**
+ * reads [address, address + size) of the process into data, leaving what is
+ * in holes alone. Every page which is wanted is its own iovec, so that when
+ * a read stops part way the page it stopped at is known, that page is
+ * marked as unreadable and the rest are tried again
+ *
+ * @brief QHexProcessDevice::readPages
+ * @param data
+ * @param address
+ * @param size
+ * @return false if the process can't be read at all
+ */
+bool QHexProcessDevice::readPages(char *data, uint64_t address, uint64_t size) {
+
+#ifdef Q_OS_LINUX
+	const uint64_t page = page_size();
+	const uint64_t end  = address + size;
+
+	std::vector<iovec> local;
+	std::vector<iovec> remote;
+
+	for (auto it = regionAfter(address); it != regions_.end() && it->start < end; ++it) {
+		if (!it->readable) {
+			continue;
+		}
+
+		uint64_t from     = std::max(address, it->start);
+		const uint64_t to = std::min(end, it->end);
+
+		while (from < to) {
+			const uint64_t start = from & ~(page - 1);
+			const uint64_t next  = std::min(start + page, to);
+
+			if (!unreadable_.contains(start)) {
+				local.push_back(iovec{data + (from - address), static_cast<size_t>(next - from)});
+				remote.push_back(iovec{reinterpret_cast<void *>(from), static_cast<size_t>(next - from)});
+			}
+
+			from = next;
+		}
+	}
+
+	auto mark_unreadable = [&](size_t index) {
+		std::memset(local[index].iov_base, 0, local[index].iov_len);
+		unreadable_.insert(reinterpret_cast<uint64_t>(remote[index].iov_base) & ~(page - 1));
+	};
+
+	size_t done = 0;
+	while (done < local.size()) {
+		const size_t count = std::min(local.size() - done, max_iovecs);
+
+		if (useReadv_) {
+			ssize_t n = process_vm_readv(static_cast<pid_t>(pid_), &local[done], count, &remote[done], count, 0);
+
+			if (n == -1) {
+				if (errno == EPERM || errno == ENOSYS) {
+					// /proc/<pid>/mem is allowed in some setups where this isn't
+					useReadv_ = false;
+					continue;
+				} else if (errno == EFAULT || errno == EIO) {
+					n = 0;
+				} else {
+					setErrorString(QString::fromLocal8Bit(strerror(errno)));
+					return false;
+				}
+			}
+
+			// the read stops at the first page which can't be read
+			size_t whole = 0;
+			while (whole < count && static_cast<size_t>(n) >= local[done + whole].iov_len) {
+				n -= static_cast<ssize_t>(local[done + whole].iov_len);
+				++whole;
+			}
+
+			done += whole;
+			if (whole < count) {
+				mark_unreadable(done++);
+			}
+		} else {
+			if (memFile_ == -1) {
+				memFile_ = ::open(QStringLiteral("/proc/%1/mem").arg(pid_).toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+				if (memFile_ == -1) {
+					setErrorString(QString::fromLocal8Bit(strerror(errno)));
+					return false;
+				}
+			}
+
+			for (; done < local.size(); ++done) {
+				ssize_t n;
+				do {
+					n = pread(memFile_, local[done].iov_base, local[done].iov_len, static_cast<off_t>(reinterpret_cast<uint64_t>(remote[done].iov_base)));
+				} while (n == -1 && errno == EINTR);
+
+				if (n != static_cast<ssize_t>(local[done].iov_len)) {
+					mark_unreadable(done);
+				}
+			}
+		}
+	}
+
+	return true;
+#else
+	Q_UNUSED(data)
+	Q_UNUSED(address)
+	Q_UNUSED(size)
+	return false;
+#endif
+}
+
+/**
+ * @brief QHexProcessDevice::readData
+ * @param data
+ * @param maxSize
+ * @return the number of bytes read, holes read as zero, or -1 if the process
+ * can't be read, for instance because it has exited
+ */
+qint64 QHexProcessDevice::readData(char *data, qint64 maxSize) {
+
+	const int64_t first = pos();
+	const int64_t last  = std::min<int64_t>(first + maxSize, size());
+
+	if (first >= last) {
+		return 0;
+	}
+
+	std::memset(data, 0, static_cast<size_t>(last - first));
+
+	if (!readPages(data, windowStart_ + static_cast<uint64_t>(first), static_cast<uint64_t>(last - first))) {
+		return -1;
+	}
+
+	return last - first;
+}
+
+/**
+ * @brief QHexProcessDevice::writeData
+ * @return -1, the device is read only
+ */
+qint64 QHexProcessDevice::writeData(const char *data, qint64 maxSize) {
+	Q_UNUSED(data)
+	Q_UNUSED(maxSize)
+	return -1;
+}
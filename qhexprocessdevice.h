@@ -0,0 +1,95 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXPROCESSDEVICE_H_
+#define QHEXPROCESSDEVICE_H_
+
+#include "qhexregiondevice.h"
+#include <QSet>
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+/**
+ * the memory of another running process, which is Linux only. The device
+ * is a window onto the address space of the process, by default the first
+ * readable mapping, see setWindow(). Addresses which aren't mapped, or which
+ * are mapped without read access, are holes. The pages are read with
+ * process_vm_readv(), all that are asked for in one call, or from
+ * /proc/<pid>/mem when that isn't allowed. A page which can't be read even
+ * though it is mapped, such as a guard page or one past the end of a mapped
+ * file, becomes a hole too rather than failing the whole read.
+ *
+ * Reading another process needs the same permission as attaching a debugger
+ * to it. The mappings are only read by refreshRegions(), and anything which
+ * has read the device, such as a QHexPageCache, has to be told when the
+ * window or the memory changes
+ */
+class QHexProcessDevice : public QHexRegionDevice {
+	Q_OBJECT
+
+public:
+	// a line of /proc/<pid>/maps
+	struct Region {
+		uint64_t start;
+		uint64_t end;
+		bool readable;
+		QString name; // the mapped file or a name such as [stack], if any
+	};
+
+public:
+	explicit QHexProcessDevice(qint64 pid, QObject *parent = nullptr);
+	~QHexProcessDevice() override;
+
+public:
+	bool refreshRegions(QString *error = nullptr);
+	void setWindow(uint64_t address, uint64_t size);
+
+public:
+	qint64 pid() const { return pid_; }
+	const std::vector<Region> &regions() const { return regions_; }
+	uint64_t windowSize() const { return windowSize_; }
+
+public:
+	uint64_t baseAddress() const override { return windowStart_; }
+	void holeMask(int64_t offset, int size, bool *out) const override;
+	int64_t nextData(int64_t offset) const override;
+	int64_t nextHole(int64_t offset) const override;
+
+public:
+	bool open(OpenMode mode) override;
+	void close() override;
+	bool isSequential() const override;
+	qint64 size() const override;
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override;
+	qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+	std::vector<Region>::const_iterator regionAfter(uint64_t address) const;
+	bool readPages(char *data, uint64_t address, uint64_t size);
+
+private:
+	qint64 pid_;
+	std::vector<Region> regions_; // sorted by address
+	QSet<uint64_t> unreadable_;   // pages which are mapped but failed to read
+	uint64_t windowStart_ = 0;
+	uint64_t windowSize_  = 0;
+	int memFile_          = -1;   // /proc/<pid>/mem, once process_vm_readv is refused
+	bool useReadv_        = true;
+};
+
+#endif
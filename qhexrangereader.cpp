@@ -0,0 +1,109 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexrangereader.h"
+
+#include <QBuffer>
+
+#include <algorithm>
+
+/**
+ * @brief QHexRangeReader::QHexRangeReader
+ * @param device
+ * @param ranges the ranges to read, in the order they are to be read
+ * @param chunk_size the most bytes in a chunk
+ */
+QHexRangeReader::QHexRangeReader(QIODevice *device, std::vector<QHexSelection::Range> ranges, int chunk_size)
+	: device_(device), memory_(qobject_cast<QBuffer *>(device)), ranges_(std::move(ranges)), chunkSize_(std::max(chunk_size, 1)) {
+
+	// empty ranges would end the reading early
+	ranges_.erase(std::remove_if(ranges_.begin(), ranges_.end(), [](const QHexSelection::Range &range) {
+					  return range.start >= range.end;
+				  }),
+				  ranges_.end());
+
+	rewind();
+}
+
+/**
+ * @brief QHexRangeReader::size
+ * @return the number of bytes in all of the ranges
+ */
+int64_t QHexRangeReader::size() const {
+	int64_t size = 0;
+	for (const QHexSelection::Range &range : ranges_) {
+		size += range.end - range.start;
+	}
+	return size;
+}
+
+/**
+ * starts reading from the beginning of the first range again
+ *
+ * @brief QHexRangeReader::rewind
+ */
+void QHexRangeReader::rewind() {
+	range_     = 0;
+	position_  = ranges_.empty() ? 0 : ranges_.front().start;
+	truncated_ = false;
+}
+
+/**
+ * @brief QHexRangeReader::next
+ * @param chunk receives the next chunk
+ * @return false once every range has been read, or if the data ends before
+ * a range does
+ */
+bool QHexRangeReader::next(Chunk *chunk) {
+
+	if (atEnd()) {
+		return false;
+	}
+
+	const QHexSelection::Range &range = ranges_[range_];
+	const int64_t wanted              = std::min<int64_t>(range.end - position_, chunkSize_);
+
+	chunk->offset = position_;
+
+	if (memory_) {
+		const QByteArray &bytes = memory_->data();
+		chunk->size             = std::max<int64_t>(std::min<int64_t>(wanted, bytes.size() - position_), 0);
+		chunk->data             = chunk->size ? bytes.constData() + position_ : nullptr;
+	} else {
+		buffer_.resize(static_cast<int>(wanted));
+
+		int64_t n = -1;
+		if (device_->seek(position_)) {
+			n = device_->read(buffer_.data(), wanted);
+		}
+
+		chunk->data = buffer_.constData();
+		chunk->size = std::max<int64_t>(n, 0);
+	}
+
+	if (chunk->size == 0) {
+		// the data ended early, there is nothing more to read
+		range_     = ranges_.size();
+		truncated_ = true;
+		return false;
+	}
+
+	position_ += chunk->size;
+	if (position_ == range.end && ++range_ != ranges_.size()) {
+		position_ = ranges_[range_].start;
+	}
+
+	return true;
+}
@@ -0,0 +1,85 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXRANGEREADER_H_
+#define QHEXRANGEREADER_H_
+
+#include "qhexselection.h"
+#include <QByteArray>
+#include <cstdint>
+#include <vector>
+
+class QBuffer;
+class QIODevice;
+
+/**
+ * reads one or more ranges of a device a chunk at a time, so that a large
+ * selection can be processed without holding all of it in memory. Chunks
+ * point into the device's own memory when it is a QBuffer, and otherwise
+ * into a single buffer of the chunk size which is reused for every chunk.
+ * Either way a chunk is only valid until the next one is read
+ */
+class QHexRangeReader {
+public:
+	static constexpr int DefaultChunkSize = 64 * 1024;
+
+	struct Chunk {
+		int64_t offset;   // where the bytes are in the device
+		const char *data;
+		int64_t size;
+	};
+
+public:
+	QHexRangeReader(QIODevice *device, std::vector<QHexSelection::Range> ranges, int chunk_size = DefaultChunkSize);
+
+public:
+	bool next(Chunk *chunk);
+	void rewind();
+
+public:
+	int64_t size() const;
+
+	/**
+	 * calls func with every chunk in order, as long as it returns true
+	 *
+	 * @return true if every chunk was visited, false if func stopped early or
+	 * the data ended before the ranges did
+	 */
+	template <class Func>
+	bool forEach(Func func) {
+		Chunk chunk;
+		while (next(&chunk)) {
+			if (!func(chunk)) {
+				return false;
+			}
+		}
+		return !truncated_;
+	}
+
+	bool atEnd() const { return range_ == ranges_.size(); }
+	bool truncated() const { return truncated_; }
+
+private:
+	QIODevice *device_;
+	QBuffer *memory_;                          // device_ when its bytes can be pointed at directly, otherwise nullptr
+	std::vector<QHexSelection::Range> ranges_;
+	QByteArray buffer_;                        // holds the current chunk unless the device is in memory
+	size_t range_     = 0;                     // the range being read
+	int64_t position_ = 0;                     // the next byte of that range
+	int chunkSize_;
+	bool truncated_ = false;                   // the data ended before the ranges did
+};
+
+#endif
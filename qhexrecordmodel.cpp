@@ -0,0 +1,423 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexrecordmodel.h"
+#include "qhexpagecache.h"
+
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QtConcurrentRun>
+#include <QtEndian>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+// the most bytes of a field which are needed to show it
+constexpr int max_field_preview = 32;
+
+constexpr uint64_t sign_bit = Q_UINT64_C(0x8000000000000000);
+
+/**
+ * @brief float_key
+ * @param value
+ * @return a key which sorts doubles in numeric order when compared as an
+ * unsigned integer, negative values have all of their bits flipped so larger
+ * magnitudes sort first
+ */
+uint64_t float_key(double value) {
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits & sign_bit) ? ~bits : (bits | sign_bit);
+}
+
+}
+
+/**
+ * @brief QHexRecordModel::QHexRecordModel
+ * @param cache the cache of the device holding the records, usually the one
+ * of the QHexView showing it
+ * @param parent
+ */
+QHexRecordModel::QHexRecordModel(std::shared_ptr<QHexPageCache> cache, QObject *parent)
+	: QAbstractTableModel(parent), cache_(std::move(cache)) {
+
+	sortTimer_ = new QTimer(this);
+	connect(sortTimer_, &QTimer::timeout, this, &QHexRecordModel::readSortKeys);
+}
+
+/**
+ * lays count records of the structure described by declaration out in a row,
+ * starting at offset. The number of records is cut down to what fits in the
+ * data, the last one may be cut short. See QHexStructure for the syntax, the
+ * records have to have a fixed size
+ *
+ * @brief QHexRecordModel::setLayout
+ * @param declaration
+ * @param offset
+ * @param count
+ * @param error receives a description of the problem if the layout is invalid
+ * @return true if the layout was set
+ */
+bool QHexRecordModel::setLayout(const QString &declaration, int64_t offset, int64_t count, QString *error) {
+
+	QHexStructure structure;
+	if (!structure.parse(declaration, error)) {
+		return false;
+	}
+
+	const int64_t record_size = structure.fixedSize();
+	if (record_size <= 0) {
+		if (error) {
+			*error = tr("the records of a table must have a fixed size");
+		}
+		return false;
+	}
+
+	beginResetModel();
+	cancelSort();
+
+	structure_  = std::move(structure);
+	offset_     = offset;
+	recordSize_ = record_size;
+
+	fieldOffsets_.clear();
+	for (size_t i = 0; i < structure_.fields().size(); ++i) {
+		fieldOffsets_.push_back(structure_.fieldOffset(static_cast<int>(i)));
+	}
+
+	const int64_t available = std::max<int64_t>(cache_->size() - offset_, 0);
+	const int64_t records   = std::min(count, (available + recordSize_ - 1) / recordSize_);
+
+	// a table can't have more rows than an int can count
+	rows_ = static_cast<int>(std::min<int64_t>(records, INT_MAX));
+	order_.clear();
+
+	endResetModel();
+	return true;
+}
+
+/**
+ * @brief QHexRecordModel::setBigEndian
+ * @param value true if multi-byte fields are stored most significant byte first
+ */
+void QHexRecordModel::setBigEndian(bool value) {
+	bigEndian_ = value;
+
+	// the keys read so far were read the other way around
+	if (isSorting()) {
+		sort(sortColumn_, sortOrder_);
+	}
+
+	if (rows_ != 0) {
+		Q_EMIT dataChanged(index(0, 0), index(rows_ - 1, columnCount() - 1));
+	}
+}
+
+/**
+ * @brief QHexRecordModel::recordOffset
+ * @param row
+ * @return where the record shown in the row starts
+ */
+int64_t QHexRecordModel::recordOffset(int row) const {
+	return offset_ + recordIndex(row) * recordSize_;
+}
+
+/**
+ * @brief QHexRecordModel::recordIndex
+ * @param row
+ * @return the index of the record shown in the row
+ */
+int64_t QHexRecordModel::recordIndex(int row) const {
+	return order_.empty() ? row : order_[row];
+}
+
+/**
+ * @brief QHexRecordModel::columnCount
+ * @param parent
+ * @return
+ */
+int QHexRecordModel::columnCount(const QModelIndex &parent) const {
+	return parent.isValid() ? 0 : static_cast<int>(structure_.fields().size());
+}
+
+/**
+ * @brief QHexRecordModel::rowCount
+ * @param parent
+ * @return
+ */
+int QHexRecordModel::rowCount(const QModelIndex &parent) const {
+	return parent.isValid() ? 0 : rows_;
+}
+
+/**
+ * reads only the bytes of the field which are needed to show it
+ *
+ * @brief QHexRecordModel::data
+ * @param index
+ * @param role
+ * @return
+ */
+QVariant QHexRecordModel::data(const QModelIndex &index, int role) const {
+
+	if (!index.isValid()) {
+		return QVariant();
+	}
+
+	const QHexStructure::Field &field = structure_.fields()[index.column()];
+
+	switch (role) {
+	case Qt::DisplayRole: {
+		const int64_t offset = recordOffset(index.row()) + fieldOffsets_[index.column()];
+
+		char data[max_field_preview];
+		const int64_t size = cache_->read(offset, data, std::min<int64_t>(structure_.fieldSize(index.column()), max_field_preview));
+		return structure_.format(index.column(), data, size, bigEndian_);
+	}
+	case Qt::TextAlignmentRole:
+		if (!field.array && field.type != QHexStructure::Char) {
+			return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+		}
+		break;
+	}
+
+	return QVariant();
+}
+
+/**
+ * columns are named after the fields, rows after the index of the record
+ * they show
+ *
+ * @brief QHexRecordModel::headerData
+ * @param section
+ * @param orientation
+ * @param role
+ * @return
+ */
+QVariant QHexRecordModel::headerData(int section, Qt::Orientation orientation, int role) const {
+
+	if (role != Qt::DisplayRole) {
+		return QVariant();
+	}
+
+	if (orientation == Qt::Horizontal) {
+		const QHexStructure::Field &field = structure_.fields()[section];
+		return field.array ? QString("%1[%2]").arg(field.name).arg(field.count) : field.name;
+	}
+
+	return QString::number(recordIndex(section));
+}
+
+/**
+ * @brief QHexRecordModel::sortKey
+ * @param data the first bytes of the field, as many as it has up to 8
+ * @param column
+ * @return a key for the field which sorts in the order of its values when
+ * compared as an unsigned integer. Arrays sort by their first 8 bytes
+ */
+uint64_t QHexRecordModel::sortKey(const uchar *data, int column) const {
+
+	const QHexStructure::Field &field = structure_.fields()[column];
+
+	if (field.array) {
+		uchar padded[sizeof(uint64_t)] = {};
+		std::memcpy(padded, data, std::min<int64_t>(structure_.fieldSize(column), sizeof(padded)));
+		return qFromBigEndian<quint64>(padded);
+	}
+
+	auto load = [&](auto zero) {
+		using T = decltype(zero);
+		return bigEndian_ ? qFromBigEndian<T>(data) : qFromLittleEndian<T>(data);
+	};
+
+	switch (field.type) {
+	case QHexStructure::UInt8:
+	case QHexStructure::Char:
+		return data[0];
+	case QHexStructure::UInt16:
+		return load(quint16());
+	case QHexStructure::UInt32:
+		return load(quint32());
+	case QHexStructure::UInt64:
+		return load(quint64());
+	case QHexStructure::Int8:
+		return static_cast<uint64_t>(static_cast<int64_t>(static_cast<qint8>(data[0]))) ^ sign_bit;
+	case QHexStructure::Int16:
+		return static_cast<uint64_t>(static_cast<int64_t>(load(qint16()))) ^ sign_bit;
+	case QHexStructure::Int32:
+		return static_cast<uint64_t>(static_cast<int64_t>(load(qint32()))) ^ sign_bit;
+	case QHexStructure::Int64:
+		return static_cast<uint64_t>(load(qint64())) ^ sign_bit;
+	case QHexStructure::Float: {
+		const quint32 bits = load(quint32());
+		float f;
+		std::memcpy(&f, &bits, sizeof(f));
+		return float_key(f);
+	}
+	case QHexStructure::Double: {
+		const quint64 bits = load(quint64());
+		double d;
+		std::memcpy(&d, &bits, sizeof(d));
+		return float_key(d);
+	}
+	}
+
+	return 0;
+}
+
+/**
+ * orders the rows by the values in a column, records with equal values stay
+ * in the order they are in the data. A column of -1 puts the records back in
+ * their natural order straight away, any other column starts reading the
+ * keys in the background and the rows are put in order once they are
+ * sorted, see isSorting. Sorting again before that replaces the sort
+ *
+ * @brief QHexRecordModel::sort
+ * @param column
+ * @param order
+ */
+void QHexRecordModel::sort(int column, Qt::SortOrder order) {
+
+	if (column < -1 || column >= columnCount()) {
+		return;
+	}
+
+	cancelSort();
+
+	if (column == -1) {
+		setOrder({}, {});
+		return;
+	}
+
+	sortColumn_ = column;
+	sortOrder_  = order;
+	sortEntries_.reserve(rows_);
+	sortTimer_->start(0);
+}
+
+/**
+ * forgets the sort being prepared, if there is one
+ *
+ * @brief QHexRecordModel::cancelSort
+ */
+void QHexRecordModel::cancelSort() {
+	++sortGeneration_;
+	sortColumn_ = -1;
+	sortTimer_->stop();
+	std::vector<SortEntry>().swap(sortEntries_);
+}
+
+/**
+ * reads the keys of the next slice of records, called whenever the event
+ * loop is idle while sorting. Once every key has been read they are sorted
+ * on another thread
+ *
+ * @brief QHexRecordModel::readSortKeys
+ */
+void QHexRecordModel::readSortKeys() {
+
+	const int64_t first   = static_cast<int64_t>(sortEntries_.size());
+	const int64_t records = std::min<int64_t>(std::max<int64_t>(SortSliceSize / recordSize_, 1), rows_ - first);
+
+	// whole records are read at once, which is one pass over the pages
+	// rather than a lookup for each record
+	const int64_t key_offset = fieldOffsets_[sortColumn_];
+	const int64_t key_size   = std::min<int64_t>(structure_.fieldSize(sortColumn_), sizeof(uint64_t));
+
+	QByteArray slice(static_cast<int>(records * recordSize_), Qt::Uninitialized);
+	const int64_t size = cache_->read(offset_ + first * recordSize_, slice.data(), slice.size());
+
+	for (int64_t i = 0; i < records; ++i) {
+		const int64_t start = i * recordSize_ + key_offset;
+
+		// a key cut short by the end of the data sorts first
+		const uint64_t key = (start + key_size <= size) ? sortKey(reinterpret_cast<const uchar *>(slice.constData() + start), sortColumn_) : 0;
+		sortEntries_.push_back(SortEntry{key, static_cast<uint32_t>(first + i)});
+	}
+
+	if (static_cast<int64_t>(sortEntries_.size()) < rows_) {
+		return;
+	}
+
+	sortTimer_->stop();
+
+	// the results are only ever touched by one thread at a time, the worker
+	// until it finishes and then this one
+	auto entries         = std::make_shared<std::vector<SortEntry>>(std::move(sortEntries_));
+	auto order           = std::make_shared<std::vector<uint32_t>>();
+	auto rows            = std::make_shared<std::vector<uint32_t>>();
+	const bool ascending = sortOrder_ == Qt::AscendingOrder;
+	const int generation = sortGeneration_;
+
+	sortEntries_.clear();
+
+	auto watcher = new QFutureWatcher<void>(this);
+	connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher, generation, order, rows]() {
+		watcher->deleteLater();
+		if (generation == sortGeneration_) {
+			sortColumn_ = -1;
+			setOrder(std::move(*order), *rows);
+		}
+	});
+
+	watcher->setFuture(QtConcurrent::run([entries, order, rows, ascending]() {
+		if (ascending) {
+			std::sort(entries->begin(), entries->end(), [](const SortEntry &lhs, const SortEntry &rhs) {
+				return lhs.key != rhs.key ? lhs.key < rhs.key : lhs.record < rhs.record;
+			});
+		} else {
+			std::sort(entries->begin(), entries->end(), [](const SortEntry &lhs, const SortEntry &rhs) {
+				return lhs.key != rhs.key ? lhs.key > rhs.key : lhs.record < rhs.record;
+			});
+		}
+
+		order->reserve(entries->size());
+		rows->resize(entries->size());
+		for (const SortEntry &entry : *entries) {
+			(*rows)[entry.record] = static_cast<uint32_t>(order->size());
+			order->push_back(entry.record);
+		}
+	}));
+}
+
+/**
+ * shows the records in a new order, keeping whatever views have selected or
+ * are looking at on the same records
+ *
+ * @brief QHexRecordModel::setOrder
+ * @param order the record shown in each row, empty for their natural order
+ * @param rows the row of each record in the new order, empty for their
+ * natural order
+ */
+void QHexRecordModel::setOrder(std::vector<uint32_t> order, const std::vector<uint32_t> &rows) {
+
+	Q_EMIT layoutAboutToBeChanged();
+
+	const QModelIndexList from = persistentIndexList();
+
+	QModelIndexList to;
+	to.reserve(from.size());
+	for (const QModelIndex &index : from) {
+		const int64_t record = recordIndex(index.row());
+		to.append(this->index(rows.empty() ? static_cast<int>(record) : static_cast<int>(rows[record]), index.column()));
+	}
+
+	order_ = std::move(order);
+	changePersistentIndexList(from, to);
+
+	Q_EMIT layoutChanged();
+}
@@ -0,0 +1,93 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXRECORDMODEL_H_
+#define QHEXRECORDMODEL_H_
+
+#include "qhexstructure.h"
+#include <QAbstractTableModel>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class QHexPageCache;
+class QTimer;
+
+/**
+ * shows an array of fixed size records as a table, one record per row and
+ * one field per column. Nothing is read until a view asks for a cell, and
+ * then only the bytes of that field are read, through the same page cache
+ * as the QHexView showing the data. Sorting reads the sort key of every
+ * record, a slice of records at a time whenever the event loop is idle, and
+ * then sorts the keys on another thread, so the table can still be browsed
+ * while a large one is sorted. The rows change order when the sort is done.
+ * Only the keys are kept while sorting, and the order of the records
+ * afterwards
+ */
+class QHexRecordModel : public QAbstractTableModel {
+	Q_OBJECT
+
+public:
+	explicit QHexRecordModel(std::shared_ptr<QHexPageCache> cache, QObject *parent = nullptr);
+
+public:
+	bool setLayout(const QString &declaration, int64_t offset, int64_t count, QString *error = nullptr);
+	void setBigEndian(bool value);
+
+public:
+	const QHexStructure &structure() const { return structure_; }
+	int64_t recordOffset(int row) const;
+	bool isSorting() const { return sortColumn_ != -1; }
+
+public:
+	int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+	struct SortEntry {
+		uint64_t key;
+		uint32_t record;
+	};
+
+	int64_t recordIndex(int row) const;
+	uint64_t sortKey(const uchar *data, int column) const;
+	void readSortKeys();
+	void cancelSort();
+	void setOrder(std::vector<uint32_t> order, const std::vector<uint32_t> &rows);
+
+private:
+	// how much of the records is read for their keys each time the event loop is idle
+	static constexpr int64_t SortSliceSize = 4 * 1024 * 1024;
+
+	std::shared_ptr<QHexPageCache> cache_;
+	QHexStructure structure_;
+	std::vector<int64_t> fieldOffsets_; // where each field starts within a record
+	std::vector<uint32_t> order_;       // the record shown in each row, empty when they are in their natural order
+	int64_t offset_     = 0;            // where the first record starts
+	int64_t recordSize_ = 0;
+	int rows_           = 0;
+	bool bigEndian_     = false;
+
+	QTimer *sortTimer_       = nullptr;
+	std::vector<SortEntry> sortEntries_; // the keys read so far by the sort being prepared
+	int sortColumn_          = -1;       // the column being sorted by, -1 when not sorting
+	Qt::SortOrder sortOrder_ = Qt::AscendingOrder;
+	int sortGeneration_      = 0; // changes whenever a sort starts or is cancelled, so the results of older ones are dropped
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXREGIONDEVICE_H_
+#define QHEXREGIONDEVICE_H_
+
+#include <QIODevice>
+#include <cstdint>
+
+/**
+ * a device which only has data at some of its offsets, such as a firmware
+ * image or the memory of a process. The rest are holes, which read as a fill
+ * byte without costing anything to read, and which QHexView leaves blank.
+ * Where holes are part of the data, as in a sparse file, they are drawn like
+ * any other bytes, see holesAreData(). Either way anything which scans the
+ * data can step over them with nextData() and nextHole(), which work like
+ * lseek() with SEEK_DATA and SEEK_HOLE. The view shows offset 0 at
+ * baseAddress()
+ */
+class QHexRegionDevice : public QIODevice {
+	Q_OBJECT
+
+public:
+	using QIODevice::QIODevice;
+
+public:
+	virtual uint64_t baseAddress() const = 0;
+
+	/**
+	 * sets out[i] to whether the byte at offset + i is in a hole, for a
+	 * whole row at a time
+	 */
+	virtual void holeMask(int64_t offset, int size, bool *out) const = 0;
+
+	/**
+	 * the first offset at or after offset which isn't in a hole, or size()
+	 * if there is none
+	 */
+	virtual int64_t nextData(int64_t offset) const = 0;
+
+	/**
+	 * the first offset at or after offset which is in a hole, or size() if
+	 * there is none
+	 */
+	virtual int64_t nextHole(int64_t offset) const = 0;
+
+	/**
+	 * whether holes are zeros which belong to the data, rather than
+	 * addresses which hold nothing
+	 */
+	virtual bool holesAreData() const { return false; }
+
+	bool isHole(int64_t offset) const {
+		bool hole;
+		holeMask(offset, 1, &hole);
+		return hole;
+	}
+};
+
+#endif
@@ -0,0 +1,295 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexrepeatindex.h"
+#include "qhexregiondevice.h"
+
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief QHexRepeatIndex::clear
+ */
+void QHexRepeatIndex::clear() {
+	reset(0, 0);
+}
+
+/**
+ * forgets everything which was found so far and prepares to scan data of the
+ * given size
+ *
+ * @brief QHexRepeatIndex::reset
+ * @param size
+ * @param bytes_per_row
+ */
+void QHexRepeatIndex::reset(int64_t size, int bytes_per_row) {
+	runs_.clear();
+	buffer_.clear();
+	previous_.clear();
+	size_        = size;
+	bytesPerRow_ = bytes_per_row;
+	rows_        = (bytes_per_row != 0) ? (size + bytes_per_row - 1) / bytes_per_row : 0;
+	scanned_     = 0;
+	runStart_    = 0;
+	runLength_   = 0;
+}
+
+/**
+ * for when the data grows, such as data which is still being decompressed.
+ * The rows found so far stay as they are and scanning carries on from where
+ * it got to. Data which shrinks is scanned again from the start
+ *
+ * @brief QHexRepeatIndex::resize
+ * @param size
+ */
+void QHexRepeatIndex::resize(int64_t size) {
+
+	if (size < size_ || bytesPerRow_ == 0) {
+		reset(size, bytesPerRow_);
+		return;
+	}
+
+	size_ = size;
+	rows_ = (size + bytesPerRow_ - 1) / bytesPerRow_;
+}
+
+/**
+ * @brief QHexRepeatIndex::finished
+ * @return true if all of the data has been scanned
+ */
+bool QHexRepeatIndex::finished() const {
+	return bytesPerRow_ == 0 || scanned_ == size_ / bytesPerRow_;
+}
+
+/**
+ * scans the next rows of the data, reading no more than about max_bytes so
+ * that it can be called from the event loop without stalling it. Rows are
+ * compared with memcmp, which the C library vectorizes, so the time spent is
+ * dominated by reading the data. The holes of a QHexRegionDevice are stepped
+ * over without being read, so sparse data takes as long as the data it
+ * really holds
+ *
+ * @brief QHexRepeatIndex::scan
+ * @param device
+ * @param max_bytes
+ * @return true if all of the data has been scanned
+ */
+bool QHexRepeatIndex::scan(QIODevice *device, int64_t max_bytes) {
+
+	if (finished()) {
+		return true;
+	}
+
+	auto region = qobject_cast<QHexRegionDevice *>(device);
+
+	// only complete rows can be repeats, a partial last row never is
+	const int64_t full_rows = size_ / bytesPerRow_;
+
+	int64_t budget = std::max<int64_t>(max_bytes, bytesPerRow_);
+
+	while (!finished()) {
+		int64_t count = std::min(budget / bytesPerRow_, full_rows - scanned_);
+		if (count == 0) {
+			break;
+		}
+
+		if (region) {
+			const int64_t offset    = scanned_ * bytesPerRow_;
+			const int64_t hole_rows = std::min((region->nextData(offset) - offset) / bytesPerRow_, full_rows - scanned_);
+
+			if (hole_rows > 1) {
+				scanHole(device, hole_rows);
+				budget -= bytesPerRow_;
+				continue;
+			}
+
+			// stop at the first row which is wholly in a hole, so that the
+			// next time around steps over it
+			const int64_t hole_row = (region->nextHole(offset) + bytesPerRow_ - 1) / bytesPerRow_;
+			count                  = std::clamp<int64_t>(hole_row - scanned_, 1, count);
+		}
+
+		if (!scanRows(device, count)) {
+			break;
+		}
+
+		budget -= count * bytesPerRow_;
+	}
+
+	return finished();
+}
+
+/**
+ * reads the next count rows and compares each with the one before it
+ *
+ * @brief QHexRepeatIndex::scanRows
+ * @param device
+ * @param count
+ * @return false if the device has less data than it claimed, in which case
+ * the scan is over
+ */
+bool QHexRepeatIndex::scanRows(QIODevice *device, int64_t count) {
+
+	buffer_.resize(static_cast<int>(count * bytesPerRow_));
+
+	int64_t read_rows = 0;
+	if (device->seek(scanned_ * bytesPerRow_)) {
+		read_rows = std::max<qint64>(device->read(buffer_.data(), buffer_.size()), 0) / bytesPerRow_;
+	}
+
+	const char *const data = buffer_.constData();
+	for (int64_t i = 0; i < read_rows; ++i) {
+
+		const char *const row      = data + i * bytesPerRow_;
+		const char *const previous = (i != 0) ? row - bytesPerRow_ : (scanned_ != 0 ? previous_.constData() : nullptr);
+
+		if (previous && std::memcmp(previous, row, bytesPerRow_) == 0) {
+			extendRun(1);
+		} else {
+			runStart_  = scanned_ + i;
+			runLength_ = 1;
+		}
+	}
+
+	if (read_rows != 0) {
+		previous_ = QByteArray(data + (read_rows - 1) * bytesPerRow_, bytesPerRow_);
+	}
+
+	// a short read means the device has less than it claimed, there is nothing
+	// more to find
+	if (read_rows != count) {
+		scanned_ = size_ / bytesPerRow_;
+		return false;
+	}
+
+	scanned_ += read_rows;
+	return true;
+}
+
+/**
+ * scans count rows which are wholly in a hole. They all read the same, so
+ * only the first of them is read and the rest join its run
+ *
+ * @brief QHexRepeatIndex::scanHole
+ * @param device
+ * @param count
+ */
+void QHexRepeatIndex::scanHole(QIODevice *device, int64_t count) {
+	if (scanRows(device, 1)) {
+		extendRun(count - 1);
+		scanned_ += count - 1;
+	}
+}
+
+/**
+ * records that the current run has grown by the given number of rows
+ *
+ * @brief QHexRepeatIndex::extendRun
+ * @param rows
+ */
+void QHexRepeatIndex::extendRun(int64_t rows) {
+
+	const int64_t before = runLength_;
+	runLength_ += rows;
+
+	if (before < MinimumRun && runLength_ >= MinimumRun) {
+		runs_.push_back(Run{runStart_, runLength_, hiddenRows()});
+	} else if (before >= MinimumRun) {
+		runs_.back().length = runLength_;
+	}
+}
+
+/**
+ * @brief QHexRepeatIndex::hiddenRows
+ * @return the number of rows hidden by all runs found so far, each run is
+ * shown as its first row plus a marker
+ */
+int64_t QHexRepeatIndex::hiddenRows() const {
+	if (runs_.empty()) {
+		return 0;
+	}
+
+	const Run &last = runs_.back();
+	return last.hidden + last.length - 2;
+}
+
+/**
+ * @brief QHexRepeatIndex::lineCount
+ * @return the number of lines needed to show all of the data
+ */
+int64_t QHexRepeatIndex::lineCount() const {
+	return rows_ - hiddenRows();
+}
+
+/**
+ * @brief QHexRepeatIndex::lineForRow
+ * @param row
+ * @return the line which shows the given row, for a hidden row this is the
+ * marker of its run
+ */
+int64_t QHexRepeatIndex::lineForRow(int64_t row) const {
+
+	auto it = std::upper_bound(runs_.begin(), runs_.end(), row, [](int64_t value, const Run &run) {
+		return value < run.row;
+	});
+
+	if (it == runs_.begin()) {
+		return row;
+	}
+
+	const Run &run           = *--it;
+	const int64_t first_line = run.row - run.hidden;
+
+	if (row == run.row) {
+		return first_line;
+	}
+
+	if (row < run.row + run.length) {
+		return first_line + 1;
+	}
+
+	return row - run.hidden - (run.length - 2);
+}
+
+/**
+ * @brief QHexRepeatIndex::line
+ * @param line
+ * @return what the given line shows
+ */
+auto QHexRepeatIndex::line(int64_t line) const -> Line {
+
+	auto it = std::upper_bound(runs_.begin(), runs_.end(), line, [](int64_t value, const Run &run) {
+		return value < run.row - run.hidden;
+	});
+
+	if (it == runs_.begin()) {
+		return Line{line, 0};
+	}
+
+	const Run &run           = *--it;
+	const int64_t first_line = run.row - run.hidden;
+
+	if (line == first_line) {
+		return Line{run.row, 0};
+	}
+
+	if (line == first_line + 1) {
+		return Line{run.row + 1, run.length - 1};
+	}
+
+	return Line{line + run.hidden + run.length - 2, 0};
+}
@@ -0,0 +1,84 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXREPEATINDEX_H_
+#define QHEXREPEATINDEX_H_
+
+#include <QByteArray>
+#include <cstdint>
+#include <vector>
+
+class QIODevice;
+
+/**
+ * finds runs of identical rows so that they can be collapsed into a single
+ * row followed by a marker, the way hexdump shows them with a '*'. The data
+ * is scanned a slice at a time with scan(), rows which have not been scanned
+ * yet are simply not collapsed. Lines are what is actually shown, rows are
+ * bytesPerRow sized pieces of the data
+ */
+class QHexRepeatIndex {
+public:
+	// what a line shows, either a row of data, or when repeats is not zero a
+	// marker standing in for the rows [row, row + repeats), all of which are
+	// identical to the row before them
+	struct Line {
+		int64_t row;
+		int64_t repeats;
+	};
+
+public:
+	void clear();
+	void reset(int64_t size, int bytes_per_row);
+	void resize(int64_t size);
+	bool scan(QIODevice *device, int64_t max_bytes);
+
+public:
+	bool finished() const;
+	int bytesPerRow() const { return bytesPerRow_; }
+	int64_t size() const { return size_; }
+	int64_t lineCount() const;
+	int64_t lineForRow(int64_t row) const;
+	Line line(int64_t line) const;
+
+private:
+	struct Run {
+		int64_t row;    // first row of the run, which is still shown
+		int64_t length; // number of rows in the run, the first one included
+		int64_t hidden; // number of rows hidden by the runs before this one
+	};
+
+	// a run only saves space once it is at least this long, shorter runs
+	// would take as many lines to show as a marker
+	static constexpr int64_t MinimumRun = 3;
+
+	int64_t hiddenRows() const;
+	bool scanRows(QIODevice *device, int64_t count);
+	void scanHole(QIODevice *device, int64_t count);
+	void extendRun(int64_t rows);
+
+private:
+	std::vector<Run> runs_;
+	QByteArray buffer_;   // rows read by the current scan
+	QByteArray previous_; // the last row read by the previous scan
+	int64_t size_      = 0;
+	int64_t rows_      = 0;
+	int64_t scanned_   = 0; // number of complete rows scanned so far
+	int64_t runStart_  = 0; // first row of the run the scan is in
+	int64_t runLength_ = 0;
+	int bytesPerRow_   = 0;
+};
+
+#endif
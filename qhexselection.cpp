@@ -0,0 +1,139 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexselection.h"
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief ends_before
+ * @return true if the range ends at or before index, this is the ordering
+ * used to find the first range which could contain index
+ */
+bool ends_before(const QHexSelection::Range &range, int64_t index) {
+	return range.end <= index;
+}
+
+}
+
+/**
+ * adds the bytes [start, end) to the selection, merging them with any ranges
+ * they overlap or touch. Adding in increasing order, as a column selection
+ * does, only ever appends
+ *
+ * @brief QHexSelection::add
+ * @param start
+ * @param end
+ */
+void QHexSelection::add(int64_t start, int64_t end) {
+
+	if (start >= end) {
+		return;
+	}
+
+	if (ranges_.empty() || ranges_.back().end < start) {
+		ranges_.push_back(Range{start, end});
+		return;
+	}
+
+	// the first range which ends at or after start, and the first which
+	// starts after end, everything in between is merged with the new one
+	auto first = std::lower_bound(ranges_.begin(), ranges_.end(), start, [](const Range &range, int64_t index) {
+		return range.end < index;
+	});
+
+	auto last = std::upper_bound(first, ranges_.end(), end, [](int64_t index, const Range &range) {
+		return index < range.start;
+	});
+
+	if (first == last) {
+		ranges_.insert(first, Range{start, end});
+		return;
+	}
+
+	first->start = std::min(first->start, start);
+	first->end   = std::max(std::prev(last)->end, end);
+	ranges_.erase(std::next(first), last);
+}
+
+/**
+ * @brief QHexSelection::clear
+ */
+void QHexSelection::clear() {
+	ranges_.clear();
+}
+
+/**
+ * @brief QHexSelection::contains
+ * @param index
+ * @return true if the byte at index is selected
+ */
+bool QHexSelection::contains(int64_t index) const {
+	auto it = std::lower_bound(ranges_.begin(), ranges_.end(), index, ends_before);
+	return it != ranges_.end() && it->start <= index;
+}
+
+/**
+ * @brief QHexSelection::start
+ * @return the first selected byte, or -1 if nothing is selected
+ */
+int64_t QHexSelection::start() const {
+	return ranges_.empty() ? -1 : ranges_.front().start;
+}
+
+/**
+ * @brief QHexSelection::end
+ * @return one past the last selected byte, or -1 if nothing is selected
+ */
+int64_t QHexSelection::end() const {
+	return ranges_.empty() ? -1 : ranges_.back().end;
+}
+
+/**
+ * @brief QHexSelection::size
+ * @return the number of selected bytes
+ */
+int64_t QHexSelection::size() const {
+	int64_t size = 0;
+	for (const Range &range : ranges_) {
+		size += range.end - range.start;
+	}
+	return size;
+}
+
+/**
+ * sets out[i] to whether the byte at offset + i is selected, for a whole row
+ * at a time. This costs a single search followed by a walk over the ranges
+ * which intersect the row
+ *
+ * @brief QHexSelection::mask
+ * @param offset
+ * @param size
+ * @param out
+ */
+void QHexSelection::mask(int64_t offset, int size, bool *out) const {
+
+	std::fill_n(out, size, false);
+
+	const int64_t row_end = offset + size;
+
+	for (auto it = std::lower_bound(ranges_.begin(), ranges_.end(), offset, ends_before); it != ranges_.end() && it->start < row_end; ++it) {
+		const int64_t first = std::max(it->start, offset);
+		const int64_t last  = std::min(it->end, row_end);
+		std::fill(out + (first - offset), out + (last - offset), true);
+	}
+}
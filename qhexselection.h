@@ -0,0 +1,52 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXSELECTION_H_
+#define QHEXSELECTION_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * a set of selected bytes, kept as sorted, non-overlapping and non-adjacent
+ * ranges so that a byte can be looked up with a binary search, and so that
+ * users of the selection can walk it range by range instead of byte by byte
+ */
+class QHexSelection {
+public:
+	// the bytes [start, end)
+	struct Range {
+		int64_t start;
+		int64_t end;
+	};
+
+public:
+	void add(int64_t start, int64_t end);
+	void clear();
+
+public:
+	bool contains(int64_t index) const;
+	bool isEmpty() const { return ranges_.empty(); }
+	const std::vector<Range> &ranges() const { return ranges_; }
+	int64_t end() const;
+	int64_t size() const;
+	int64_t start() const;
+	void mask(int64_t offset, int size, bool *out) const;
+
+private:
+	std::vector<Range> ranges_;
+};
+
+#endif
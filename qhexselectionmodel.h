@@ -0,0 +1,45 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXSELECTIONMODEL_H_
+#define QHEXSELECTIONMODEL_H_
+
+#include "qhexselection.h"
+#include <QObject>
+
+/**
+ * the selection of a device, kept apart from the views of it so that several
+ * views, such as the panes of a QHexSplitView, can show and change the same
+ * selection
+ */
+class QHexSelectionModel : public QObject {
+	Q_OBJECT
+
+public:
+	explicit QHexSelectionModel(QObject *parent = nullptr);
+
+public:
+	const QHexSelection &selection() const { return selection_; }
+	void setSelection(QHexSelection selection);
+	void clear();
+
+Q_SIGNALS:
+	void selectionChanged();
+
+private:
+	QHexSelection selection_;
+};
+
+#endif
@@ -0,0 +1,607 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexsparsedevice.h"
+
+#include <QString>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Intel HEX records are a length, 2 address bytes, a type, up to 255 data
+// bytes and a checksum, S-records are a count, up to 255 bytes and nothing
+// else, so neither ever holds more than this
+constexpr int MaxRecordBytes = 260;
+
+// how much of the file is read at a time, lines are never longer than a
+// record so anything which doesn't fit in this is not a record
+constexpr int ReadChunkSize = 1024 * 1024;
+
+struct HexTable {
+	int8_t values[256]; // value of each hex digit, -1 for everything else
+};
+
+constexpr HexTable make_hex_table() {
+	HexTable table = {};
+	for (int i = 0; i < 256; ++i) {
+		if (i >= '0' && i <= '9') {
+			table.values[i] = static_cast<int8_t>(i - '0');
+		} else if (i >= 'a' && i <= 'f') {
+			table.values[i] = static_cast<int8_t>(i - 'a' + 10);
+		} else if (i >= 'A' && i <= 'F') {
+			table.values[i] = static_cast<int8_t>(i - 'A' + 10);
+		} else {
+			table.values[i] = -1;
+		}
+	}
+	return table;
+}
+
+constexpr HexTable hex_table = make_hex_table();
+
+/**
+ * @brief decode_record
+ * @param first
+ * @param last
+ * @param out receives the bytes, room for MaxRecordBytes is needed
+ * @return the number of bytes, or -1 if the text isn't pairs of hex digits
+ */
+int decode_record(const char *first, const char *last, uint8_t *out) {
+
+	if (((last - first) & 1) || last - first > 2 * MaxRecordBytes) {
+		return -1;
+	}
+
+	int n = 0;
+	for (const char *p = first; p != last; p += 2) {
+		const int hi = hex_table.values[static_cast<uint8_t>(p[0])];
+		const int lo = hex_table.values[static_cast<uint8_t>(p[1])];
+		if ((hi | lo) < 0) {
+			return -1;
+		}
+		out[n++] = static_cast<uint8_t>((hi << 4) | lo);
+	}
+
+	return n;
+}
+
+/**
+ * @brief read_big_endian
+ * @param p
+ * @param size
+ * @return the size bytes at p as a big endian number
+ */
+uint64_t read_big_endian(const uint8_t *p, int size) {
+	uint64_t value = 0;
+	for (int i = 0; i < size; ++i) {
+		value = (value << 8) | p[i];
+	}
+	return value;
+}
+
+/**
+ * calls func with every line of the device, without its line ending. The
+ * device is read a large chunk at a time and lines are passed straight out
+ * of that chunk. Stops as soon as func returns false
+ *
+ * @brief for_each_line
+ * @param source
+ * @param func
+ * @return false if func stopped early
+ */
+template <class Func>
+bool for_each_line(QIODevice *source, Func func) {
+
+	QByteArray buffer(ReadChunkSize, Qt::Uninitialized);
+	char *const data = buffer.data();
+	int64_t kept     = 0; // bytes of an unfinished line at the start of the buffer
+
+	while (true) {
+		// a line which fills the whole buffer can't be a record, passing it on
+		// as it is lets func reject it
+		if (kept == ReadChunkSize) {
+			return func(data, data + kept);
+		}
+
+		const qint64 n = source->read(data + kept, ReadChunkSize - kept);
+		if (n <= 0) {
+			return kept == 0 || func(data, data + kept);
+		}
+
+		const char *p   = data;
+		const char *end = data + kept + n;
+
+		for (const char *eol; (eol = static_cast<const char *>(std::memchr(p, '\n', end - p))) != nullptr; p = eol + 1) {
+			if (!func(p, eol)) {
+				return false;
+			}
+		}
+
+		kept = end - p;
+		std::memmove(data, p, kept);
+	}
+}
+
+/**
+ * joins data records into segments. Records almost always follow on from
+ * each other, so this is mostly appending to the last segment, the rest are
+ * sorted out by finish
+ */
+class SegmentBuilder {
+public:
+	void append(uint64_t address, const uint8_t *data, int size) {
+		if (size == 0) {
+			return;
+		}
+
+		if (segments_.empty() || segments_.back().address + static_cast<uint64_t>(segments_.back().data.size()) != address) {
+			segments_.push_back(QHexSparseDevice::Segment{address, QByteArray()});
+		}
+
+		segments_.back().data.append(reinterpret_cast<const char *>(data), size);
+	}
+
+	/**
+	 * @brief finish
+	 * @param segments receives the segments in order of address, with the
+	 * ones which touch joined together
+	 * @param error
+	 * @return false if any records overlap
+	 */
+	bool finish(std::vector<QHexSparseDevice::Segment> *segments, QString *error) {
+
+		std::stable_sort(segments_.begin(), segments_.end(), [](const QHexSparseDevice::Segment &lhs, const QHexSparseDevice::Segment &rhs) {
+			return lhs.address < rhs.address;
+		});
+
+		segments->clear();
+
+		for (QHexSparseDevice::Segment &segment : segments_) {
+			if (!segments->empty()) {
+				QHexSparseDevice::Segment &previous = segments->back();
+				const uint64_t previous_end         = previous.address + static_cast<uint64_t>(previous.data.size());
+
+				if (segment.address < previous_end) {
+					if (error) {
+						*error = QStringLiteral("records overlap at address 0x%1").arg(static_cast<qulonglong>(segment.address), 0, 16);
+					}
+					return false;
+				}
+
+				if (segment.address == previous_end) {
+					previous.data.append(segment.data);
+					continue;
+				}
+			}
+
+			segments->push_back(std::move(segment));
+		}
+
+		segments_.clear();
+		return true;
+	}
+
+private:
+	std::vector<QHexSparseDevice::Segment> segments_;
+};
+
+/**
+ * the state carried from one record to the next while loading
+ */
+struct LoadState {
+	SegmentBuilder segments;
+	uint64_t extendedAddress = 0;  // added to the address of Intel HEX data records
+	int64_t startAddress     = -1;
+	bool finished            = false; // the end of file record has been seen
+	QString error;
+};
+
+/**
+ * @brief intel_hex_record
+ * @param record the decoded bytes of the record, after the ':'
+ * @param size
+ * @param state
+ * @return false if the record is not valid
+ */
+bool intel_hex_record(const uint8_t *record, int size, LoadState *state) {
+
+	if (size < 5 || size != record[0] + 5) {
+		state->error = QStringLiteral("the length of the record is wrong");
+		return false;
+	}
+
+	uint8_t sum = 0;
+	for (int i = 0; i < size; ++i) {
+		sum += record[i];
+	}
+
+	if (sum != 0) {
+		state->error = QStringLiteral("bad checksum");
+		return false;
+	}
+
+	const int length       = record[0];
+	const uint64_t address = read_big_endian(&record[1], 2);
+	const uint8_t *data    = &record[4];
+
+	// every record other than data has a fixed length
+	auto expect_length = [&](int expected) {
+		if (length != expected) {
+			state->error = QStringLiteral("record type %1 must hold %2 bytes").arg(record[3]).arg(expected);
+			return false;
+		}
+		return true;
+	};
+
+	switch (record[3]) {
+	case 0x00:
+		state->segments.append(state->extendedAddress + address, data, length);
+		return true;
+	case 0x01:
+		state->finished = true;
+		return true;
+	case 0x02:
+		// extended segment address, a real mode segment
+		if (!expect_length(2)) {
+			return false;
+		}
+		state->extendedAddress = read_big_endian(data, 2) << 4;
+		return true;
+	case 0x03:
+		// start segment address, CS:IP
+		if (!expect_length(4)) {
+			return false;
+		}
+		state->startAddress = static_cast<int64_t>((read_big_endian(data, 2) << 4) + read_big_endian(data + 2, 2));
+		return true;
+	case 0x04:
+		// extended linear address, the upper 16 bits of the addresses
+		if (!expect_length(2)) {
+			return false;
+		}
+		state->extendedAddress = read_big_endian(data, 2) << 16;
+		return true;
+	case 0x05:
+		// start linear address
+		if (!expect_length(4)) {
+			return false;
+		}
+		state->startAddress = static_cast<int64_t>(read_big_endian(data, 4));
+		return true;
+	default:
+		state->error = QStringLiteral("unknown record type %1").arg(record[3]);
+		return false;
+	}
+}
+
+/**
+ * @brief s_record
+ * @param type the digit after the 'S'
+ * @param record the decoded bytes of the record, after the type
+ * @param size
+ * @param state
+ * @return false if the record is not valid
+ */
+bool s_record(char type, const uint8_t *record, int size, LoadState *state) {
+
+	// the size of the address of each type, 0 for types which don't exist
+	static constexpr int address_sizes[10] = {2, 2, 3, 4, 0, 2, 3, 4, 3, 2};
+
+	if (type < '0' || type > '9' || address_sizes[type - '0'] == 0) {
+		state->error = QStringLiteral("unknown record type S%1").arg(QLatin1Char(type));
+		return false;
+	}
+
+	const int address_size = address_sizes[type - '0'];
+
+	if (size < 2 || size != record[0] + 1 || record[0] < address_size + 1) {
+		state->error = QStringLiteral("the length of the record is wrong");
+		return false;
+	}
+
+	uint8_t sum = 0;
+	for (int i = 0; i < size; ++i) {
+		sum += record[i];
+	}
+
+	if (sum != 0xff) {
+		state->error = QStringLiteral("bad checksum");
+		return false;
+	}
+
+	const uint64_t address = read_big_endian(&record[1], address_size);
+	const uint8_t *data    = &record[1 + address_size];
+	const int length       = size - 2 - address_size;
+
+	switch (type) {
+	case '1':
+	case '2':
+	case '3':
+		state->segments.append(address, data, length);
+		break;
+	case '7':
+	case '8':
+	case '9':
+		state->startAddress = static_cast<int64_t>(address);
+		state->finished     = true;
+		break;
+	default:
+		// the header and the record counts say nothing about the data
+		break;
+	}
+
+	return true;
+}
+
+}
+
+/**
+ * @brief QHexSparseDevice::QHexSparseDevice
+ * @param parent
+ */
+QHexSparseDevice::QHexSparseDevice(QObject *parent)
+	: QHexRegionDevice(parent) {
+}
+
+/**
+ * reads an Intel HEX or Motorola S-record file, which of the two is told by
+ * the first character of the first record. The file is read in a single
+ * pass and every record's checksum is checked. Once loaded the device is
+ * open for reading
+ *
+ * @brief QHexSparseDevice::load
+ * @param source
+ * @param error receives a description of the problem if loading fails
+ * @return true on success, on failure the device is left as it was
+ */
+bool QHexSparseDevice::load(QIODevice *source, QString *error) {
+
+	enum class Format {
+		Unknown,
+		IntelHex,
+		SRecord
+	};
+
+	Format format   = Format::Unknown;
+	int64_t line_no = 0;
+	LoadState state;
+
+	uint8_t record[MaxRecordBytes];
+
+	const bool read = for_each_line(source, [&](const char *first, const char *last) {
+		++line_no;
+
+		while (first != last && (*first == ' ' || *first == '\t')) {
+			++first;
+		}
+
+		while (last != first && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) {
+			--last;
+		}
+
+		// nothing after the end record counts, some tools pad files out
+		if (first == last || state.finished) {
+			return true;
+		}
+
+		if (format == Format::Unknown) {
+			format = (*first == ':') ? Format::IntelHex : (*first == 'S') ? Format::SRecord : Format::Unknown;
+		}
+
+		if (format == Format::IntelHex && *first == ':') {
+			const int size = decode_record(first + 1, last, record);
+			if (size == -1) {
+				state.error = QStringLiteral("the record is not made of hex digit pairs");
+				return false;
+			}
+			return intel_hex_record(record, size, &state);
+		}
+
+		if (format == Format::SRecord && *first == 'S' && last - first >= 2) {
+			const int size = decode_record(first + 2, last, record);
+			if (size == -1) {
+				state.error = QStringLiteral("the record is not made of hex digit pairs");
+				return false;
+			}
+			return s_record(first[1], record, size, &state);
+		}
+
+		state.error = QStringLiteral("not an Intel HEX or S-record line");
+		return false;
+	});
+
+	if (!read) {
+		if (error) {
+			*error = QStringLiteral("line %1: %2").arg(static_cast<qlonglong>(line_no)).arg(state.error);
+		}
+		return false;
+	}
+
+	std::vector<Segment> segments;
+	if (!state.segments.finish(&segments, error)) {
+		return false;
+	}
+
+	if (isOpen()) {
+		close();
+	}
+
+	segments_     = std::move(segments);
+	baseAddress_  = segments_.empty() ? 0 : segments_.front().address;
+	startAddress_ = state.startAddress;
+	return open(QIODevice::ReadOnly);
+}
+
+/**
+ * @brief QHexSparseDevice::clear
+ */
+void QHexSparseDevice::clear() {
+	segments_.clear();
+	baseAddress_  = 0;
+	startAddress_ = -1;
+}
+
+/**
+ * sets the value holes read as. Anything which has already read the device,
+ * such as a QHexPageCache, has to be told to read it again
+ *
+ * @brief QHexSparseDevice::setFillByte
+ * @param value
+ */
+void QHexSparseDevice::setFillByte(uint8_t value) {
+	fillByte_ = value;
+}
+
+/**
+ * @brief QHexSparseDevice::segmentAfter
+ * @param offset
+ * @return the segment holding offset, or else the first one after it
+ */
+auto QHexSparseDevice::segmentAfter(int64_t offset) const -> std::vector<Segment>::const_iterator {
+	const uint64_t address = baseAddress_ + static_cast<uint64_t>(offset);
+	return std::upper_bound(segments_.begin(), segments_.end(), address, [](uint64_t address, const Segment &segment) {
+		return address < segment.address + static_cast<uint64_t>(segment.data.size());
+	});
+}
+
+/**
+ * @brief QHexSparseDevice::holeMask
+ * @param offset
+ * @param size
+ * @param out
+ */
+void QHexSparseDevice::holeMask(int64_t offset, int size, bool *out) const {
+
+	std::fill_n(out, size, true);
+
+	const int64_t end = offset + size;
+
+	for (auto it = segmentAfter(std::max<int64_t>(offset, 0)); it != segments_.end(); ++it) {
+		const int64_t start = static_cast<int64_t>(it->address - baseAddress_);
+		if (start >= end) {
+			break;
+		}
+
+		const int64_t first = std::max(start, offset);
+		const int64_t last  = std::min(start + it->data.size(), end);
+		std::fill(out + (first - offset), out + (last - offset), false);
+	}
+}
+
+/**
+ * @brief QHexSparseDevice::nextData
+ * @param offset
+ * @return the first offset at or after offset which holds data, or size()
+ */
+int64_t QHexSparseDevice::nextData(int64_t offset) const {
+
+	offset = std::max<int64_t>(offset, 0);
+
+	auto it = segmentAfter(offset);
+	if (it == segments_.end()) {
+		return size();
+	}
+
+	return std::max(offset, static_cast<int64_t>(it->address - baseAddress_));
+}
+
+/**
+ * @brief QHexSparseDevice::nextHole
+ * @param offset
+ * @return the first offset at or after offset which is in a hole, or size()
+ */
+int64_t QHexSparseDevice::nextHole(int64_t offset) const {
+
+	offset = std::max<int64_t>(offset, 0);
+
+	// segments never touch, so the end of one is always a hole or the end
+	auto it = segmentAfter(offset);
+	if (it == segments_.end() || static_cast<int64_t>(it->address - baseAddress_) > offset) {
+		return std::min(offset, size());
+	}
+
+	return static_cast<int64_t>(it->address - baseAddress_) + it->data.size();
+}
+
+/**
+ * @brief QHexSparseDevice::isSequential
+ * @return false, the device can be read at any offset
+ */
+bool QHexSparseDevice::isSequential() const {
+	return false;
+}
+
+/**
+ * @brief QHexSparseDevice::size
+ * @return the number of bytes from the lowest address with data to the
+ * highest, holes included
+ */
+qint64 QHexSparseDevice::size() const {
+	if (segments_.empty()) {
+		return 0;
+	}
+
+	const Segment &last = segments_.back();
+	return static_cast<qint64>(last.address - baseAddress_) + last.data.size();
+}
+
+/**
+ * @brief QHexSparseDevice::readData
+ * @param data
+ * @param maxSize
+ * @return the number of bytes read, holes are filled with fillByte()
+ */
+qint64 QHexSparseDevice::readData(char *data, qint64 maxSize) {
+
+	const int64_t first = pos();
+	const int64_t last  = std::min<int64_t>(first + maxSize, size());
+
+	if (first >= last) {
+		return 0;
+	}
+
+	int64_t offset = first;
+	auto it        = segmentAfter(first);
+
+	while (offset < last) {
+		const int64_t start = (it == segments_.end()) ? last : std::min(static_cast<int64_t>(it->address - baseAddress_), last);
+
+		if (offset < start) {
+			std::memset(data + (offset - first), fillByte_, start - offset);
+			offset = start;
+		}
+
+		if (offset < last) {
+			const int64_t count = std::min(start + it->data.size(), last) - offset;
+			std::memcpy(data + (offset - first), it->data.constData() + (offset - start), count);
+			offset += count;
+			++it;
+		}
+	}
+
+	return last - first;
+}
+
+/**
+ * @brief QHexSparseDevice::writeData
+ * @return -1, the device is read only
+ */
+qint64 QHexSparseDevice::writeData(const char *data, qint64 maxSize) {
+	Q_UNUSED(data)
+	Q_UNUSED(maxSize)
+	return -1;
+}
@@ -0,0 +1,79 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXSPARSEDEVICE_H_
+#define QHEXSPARSEDEVICE_H_
+
+#include "qhexregiondevice.h"
+#include <QByteArray>
+#include <cstdint>
+#include <vector>
+
+/**
+ * a read only device made of blocks of data at scattered addresses, such as
+ * a firmware image loaded from an Intel HEX or Motorola S-record file. Only
+ * the blocks themselves are kept in memory, the gaps between them are holes
+ * which read as fillByte(). Offset 0 of the device is the lowest address
+ * which holds data
+ */
+class QHexSparseDevice : public QHexRegionDevice {
+	Q_OBJECT
+
+public:
+	// a run of consecutive bytes, records which follow on from each other
+	// are joined into one
+	struct Segment {
+		uint64_t address;
+		QByteArray data;
+	};
+
+public:
+	explicit QHexSparseDevice(QObject *parent = nullptr);
+
+public:
+	bool load(QIODevice *source, QString *error = nullptr);
+	void clear();
+	void setFillByte(uint8_t value);
+
+public:
+	int64_t startAddress() const { return startAddress_; }
+	uint8_t fillByte() const { return fillByte_; }
+	const std::vector<Segment> &segments() const { return segments_; }
+
+public:
+	uint64_t baseAddress() const override { return baseAddress_; }
+	void holeMask(int64_t offset, int size, bool *out) const override;
+	int64_t nextData(int64_t offset) const override;
+	int64_t nextHole(int64_t offset) const override;
+
+public:
+	bool isSequential() const override;
+	qint64 size() const override;
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override;
+	qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+	std::vector<Segment>::const_iterator segmentAfter(int64_t offset) const;
+
+private:
+	std::vector<Segment> segments_; // sorted by address, never empty or touching
+	uint64_t baseAddress_ = 0;
+	int64_t startAddress_ = -1;     // where execution starts, if the file says
+	uint8_t fillByte_     = 0xff;   // erased flash reads as all ones
+};
+
+#endif
@@ -0,0 +1,356 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexsparsefiledevice.h"
+
+#include <QFileDevice>
+#include <QHash>
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+#ifdef Q_OS_LINUX
+
+/**
+ * lseek() moves the position of the file, which QFile keeps reading and
+ * writing from, so it is put back where it was afterwards
+ *
+ * @brief seek_extent
+ * @param fd
+ * @param offset
+ * @param whence SEEK_DATA or SEEK_HOLE
+ * @return what lseek() returns
+ */
+off_t seek_extent(int fd, int64_t offset, int whence) {
+
+	const off_t position = lseek(fd, 0, SEEK_CUR);
+	const off_t result   = lseek(fd, static_cast<off_t>(offset), whence);
+	const int error      = errno;
+
+	if (position != -1) {
+		lseek(fd, position, SEEK_SET);
+	}
+
+	errno = error;
+	return result;
+}
+
+#endif
+
+}
+
+/**
+ * @brief QHexSparseFileDevice::QHexSparseFileDevice
+ * @param file an open file, which has to outlive the device
+ * @param parent
+ */
+QHexSparseFileDevice::QHexSparseFileDevice(QFileDevice *file, QObject *parent)
+	: QHexRegionDevice(parent), file_(file) {
+}
+
+/**
+ * @brief QHexSparseFileDevice::~QHexSparseFileDevice
+ */
+QHexSparseFileDevice::~QHexSparseFileDevice() {
+	close();
+}
+
+/**
+ * @brief QHexSparseFileDevice::hasHoles
+ * @param file
+ * @return true if the file is open and has at least one hole. Filesystems
+ * which don't keep track of holes never have any
+ */
+bool QHexSparseFileDevice::hasHoles(QFileDevice *file) {
+#ifdef Q_OS_LINUX
+	if (!file->isOpen() || file->handle() == -1) {
+		return false;
+	}
+
+	// writes which QFile still holds haven't made holes into data yet
+	file->flush();
+
+	const off_t hole = seek_extent(file->handle(), 0, SEEK_HOLE);
+	return hole != -1 && hole < file->size();
+#else
+	Q_UNUSED(file)
+	return false;
+#endif
+}
+
+/**
+ * every view of the same file goes through the same device, so that they
+ * share its extents and a QHexPageCache
+ *
+ * @brief QHexSparseFileDevice::forFile
+ * @param file
+ * @return the open device which reads file, which is created if nothing else
+ * is using one yet, or nullptr if it can't be opened
+ */
+std::shared_ptr<QHexSparseFileDevice> QHexSparseFileDevice::forFile(QFileDevice *file) {
+
+	static QHash<QFileDevice *, std::weak_ptr<QHexSparseFileDevice>> devices;
+
+	if (std::shared_ptr<QHexSparseFileDevice> device = devices.value(file).lock()) {
+		return device;
+	}
+
+	auto device = std::make_shared<QHexSparseFileDevice>(file);
+	if (!device->open(file->openMode())) {
+		return nullptr;
+	}
+
+	// another file may be created at the same address later on
+	if (!devices.contains(file)) {
+		connect(file, &QObject::destroyed, [file]() {
+			devices.remove(file);
+		});
+	}
+
+	devices.insert(file, device);
+	return device;
+}
+
+/**
+ * @brief QHexSparseFileDevice::extentAt
+ * @param offset
+ * @return the extent holding offset, which must be less than size()
+ */
+auto QHexSparseFileDevice::extentAt(int64_t offset) const -> Extent {
+
+	if (offset >= extent_.start && offset < extent_.end) {
+		return extent_;
+	}
+
+	const int64_t size = this->size();
+
+#ifdef Q_OS_LINUX
+	const int fd = file_->handle();
+
+	const off_t data = seek_extent(fd, offset, SEEK_DATA);
+	if (data == -1) {
+		// ENXIO means there is no data after offset, anything else that the
+		// holes can't be found, in which case it is all data
+		extent_ = (errno == ENXIO) ? Extent{offset, size, true} : Extent{offset, size, false};
+	} else if (data > offset) {
+		extent_ = Extent{offset, std::min<int64_t>(data, size), true};
+	} else {
+		const off_t hole = seek_extent(fd, offset, SEEK_HOLE);
+		extent_          = Extent{offset, (hole == -1) ? size : std::min<int64_t>(hole, size), false};
+	}
+#else
+	extent_ = Extent{offset, size, false};
+#endif
+
+	return extent_;
+}
+
+/**
+ * @brief QHexSparseFileDevice::baseAddress
+ * @return 0, offsets are file positions
+ */
+uint64_t QHexSparseFileDevice::baseAddress() const {
+	return 0;
+}
+
+/**
+ * @brief QHexSparseFileDevice::holeMask
+ * @param offset
+ * @param size
+ * @param out
+ */
+void QHexSparseFileDevice::holeMask(int64_t offset, int size, bool *out) const {
+
+	const int64_t end = std::min(offset + size, this->size());
+
+	std::fill_n(out, size, false);
+
+	for (int64_t position = std::max<int64_t>(offset, 0); position < end;) {
+		const Extent extent = extentAt(position);
+		const int64_t last  = std::min(extent.end, end);
+
+		if (extent.hole) {
+			std::fill(out + (position - offset), out + (last - offset), true);
+		}
+
+		position = last;
+	}
+}
+
+/**
+ * @brief QHexSparseFileDevice::nextData
+ * @param offset
+ * @return the first offset at or after offset which isn't in a hole, or size()
+ */
+int64_t QHexSparseFileDevice::nextData(int64_t offset) const {
+
+	const int64_t size = this->size();
+
+	for (int64_t position = std::max<int64_t>(offset, 0); position < size;) {
+		const Extent extent = extentAt(position);
+		if (!extent.hole) {
+			return position;
+		}
+
+		position = extent.end;
+	}
+
+	return size;
+}
+
+/**
+ * @brief QHexSparseFileDevice::nextHole
+ * @param offset
+ * @return the first offset at or after offset which is in a hole, or size()
+ */
+int64_t QHexSparseFileDevice::nextHole(int64_t offset) const {
+
+	const int64_t size = this->size();
+
+	for (int64_t position = std::max<int64_t>(offset, 0); position < size;) {
+		const Extent extent = extentAt(position);
+		if (extent.hole) {
+			return position;
+		}
+
+		position = extent.end;
+	}
+
+	return size;
+}
+
+/**
+ * @brief QHexSparseFileDevice::holesAreData
+ * @return true, the holes of a file read as zeros
+ */
+bool QHexSparseFileDevice::holesAreData() const {
+	return true;
+}
+
+/**
+ * @brief QHexSparseFileDevice::open
+ * @param mode
+ * @return true if the device was opened, it can only be written if the file
+ * can
+ */
+bool QHexSparseFileDevice::open(OpenMode mode) {
+
+	if ((mode & WriteOnly) && !file_->isWritable()) {
+		return false;
+	}
+
+	extent_ = Extent{0, 0, false};
+	return QIODevice::open((mode & ReadWrite) | Unbuffered);
+}
+
+/**
+ * @brief QHexSparseFileDevice::close
+ */
+void QHexSparseFileDevice::close() {
+	if (isOpen()) {
+		QIODevice::close();
+	}
+}
+
+/**
+ * @brief QHexSparseFileDevice::isSequential
+ * @return false, the device can be read at any offset
+ */
+bool QHexSparseFileDevice::isSequential() const {
+	return false;
+}
+
+/**
+ * @brief QHexSparseFileDevice::size
+ * @return the size of the file, holes included
+ */
+qint64 QHexSparseFileDevice::size() const {
+	return file_->size();
+}
+
+/**
+ * @brief QHexSparseFileDevice::readData
+ * @param data
+ * @param maxSize
+ * @return the number of bytes read, or -1 if the file couldn't be read
+ */
+qint64 QHexSparseFileDevice::readData(char *data, qint64 maxSize) {
+
+	const int64_t first = pos();
+	const int64_t last  = std::min<int64_t>(first + maxSize, size());
+
+	int64_t offset = first;
+
+	while (offset < last) {
+		const Extent extent = extentAt(offset);
+		const int64_t end   = std::min(extent.end, last);
+
+		if (extent.hole) {
+			std::memset(data + (offset - first), 0, static_cast<size_t>(end - offset));
+		} else {
+			if (!file_->seek(offset)) {
+				break;
+			}
+
+			const qint64 n = file_->read(data + (offset - first), end - offset);
+			if (n != end - offset) {
+				offset += std::max<qint64>(n, 0);
+				break;
+			}
+		}
+
+		offset = end;
+	}
+
+	if (offset == first && first < last) {
+		setErrorString(file_->errorString());
+		return -1;
+	}
+
+	return offset - first;
+}
+
+/**
+ * @brief QHexSparseFileDevice::writeData
+ * @param data
+ * @param maxSize
+ * @return the number of bytes written, or -1 if the file couldn't be written
+ */
+qint64 QHexSparseFileDevice::writeData(const char *data, qint64 maxSize) {
+
+	// writing into a hole turns it into data
+	extent_ = Extent{0, 0, false};
+
+	if (!file_->seek(pos())) {
+		setErrorString(file_->errorString());
+		return -1;
+	}
+
+	const qint64 n = file_->write(data, maxSize);
+	if (n == -1 || !file_->flush()) {
+		setErrorString(file_->errorString());
+		return -1;
+	}
+
+	return n;
+}
@@ -0,0 +1,81 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXSPARSEFILEDEVICE_H_
+#define QHEXSPARSEFILEDEVICE_H_
+
+#include "qhexregiondevice.h"
+#include <cstdint>
+#include <memory>
+
+class QFileDevice;
+
+/**
+ * a sparse file, such as a disk or virtual machine image, read so that its
+ * holes cost nothing. The holes are found with lseek() and SEEK_DATA or
+ * SEEK_HOLE as they are needed, so nothing is scanned up front however big
+ * the file is, and they read as zeros without going to the file. Holes are
+ * part of the data, see holesAreData(), so they are drawn as zeros too.
+ * Writing goes straight to the file. Finding holes is Linux only, elsewhere
+ * the whole file is data
+ */
+class QHexSparseFileDevice : public QHexRegionDevice {
+	Q_OBJECT
+
+public:
+	explicit QHexSparseFileDevice(QFileDevice *file, QObject *parent = nullptr);
+	~QHexSparseFileDevice() override;
+
+public:
+	static bool hasHoles(QFileDevice *file);
+	static std::shared_ptr<QHexSparseFileDevice> forFile(QFileDevice *file);
+
+public:
+	QFileDevice *file() const { return file_; }
+
+public:
+	uint64_t baseAddress() const override;
+	void holeMask(int64_t offset, int size, bool *out) const override;
+	int64_t nextData(int64_t offset) const override;
+	int64_t nextHole(int64_t offset) const override;
+	bool holesAreData() const override;
+
+public:
+	bool open(OpenMode mode) override;
+	void close() override;
+	bool isSequential() const override;
+	qint64 size() const override;
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override;
+	qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+	// a run of data or a hole, from the offset it was looked up at, which
+	// isn't necessarily where it starts
+	struct Extent {
+		int64_t start;
+		int64_t end;
+		bool hole;
+	};
+
+	Extent extentAt(int64_t offset) const;
+
+private:
+	QFileDevice *file_;
+	mutable Extent extent_ = {0, 0, false}; // the extent looked up last
+};
+
+#endif
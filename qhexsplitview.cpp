@@ -0,0 +1,203 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexsplitview.h"
+#include "qhexselectionmodel.h"
+#include "qhexview.h"
+
+#include <QBuffer>
+#include <QHBoxLayout>
+#include <QScrollBar>
+#include <QSplitter>
+
+#include <algorithm>
+
+/**
+ * @brief QHexSplitView::QHexSplitView
+ * @param parent
+ */
+QHexSplitView::QHexSplitView(QWidget *parent)
+	: QWidget(parent) {
+
+	selectionModel_ = new QHexSelectionModel(this);
+	splitter_       = new QSplitter(Qt::Horizontal, this);
+
+	auto layout = new QHBoxLayout(this);
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->addWidget(splitter_);
+
+	addPane();
+}
+
+/**
+ * @brief QHexSplitView::~QHexSplitView
+ */
+QHexSplitView::~QHexSplitView() = default;
+
+/**
+ * adds a pane showing the same data as the others, with the same address
+ * offset as the first pane and otherwise the default settings
+ *
+ * @brief QHexSplitView::addPane
+ * @return the new pane
+ */
+QHexView *QHexSplitView::addPane() {
+
+	auto pane = new QHexView(splitter_);
+	pane->setSelectionModel(selectionModel_);
+
+	if (!panes_.empty()) {
+		pane->setAddressOffset(panes_.front()->addressOffset());
+	}
+
+	if (data_) {
+		pane->setData(data_);
+	}
+
+	connect(pane->verticalScrollBar(), &QScrollBar::valueChanged, this, [this, pane]() {
+		paneScrolled(pane);
+	});
+
+	splitter_->addWidget(pane);
+	panes_.push_back(pane);
+	return pane;
+}
+
+/**
+ * @brief QHexSplitView::removePane
+ * @param pane
+ */
+void QHexSplitView::removePane(QHexView *pane) {
+	auto it = std::find(panes_.begin(), panes_.end(), pane);
+	if (it != panes_.end()) {
+		panes_.erase(it);
+		delete pane;
+	}
+}
+
+/**
+ * shows the data in every pane. Devices which can't seek are read once into
+ * a buffer which all of the panes share
+ *
+ * @brief QHexSplitView::setData
+ * @param d
+ */
+void QHexSplitView::setData(QIODevice *d) {
+
+	if (d->isSequential() || !d->size()) {
+		auto buffer = std::make_unique<QBuffer>();
+		buffer->setData(d->readAll());
+		buffer->open(QBuffer::ReadOnly);
+		data_ = buffer.get();
+
+		// the panes let go of the old buffer before it is deleted
+		for (QHexView *pane : panes_) {
+			pane->setData(data_);
+		}
+
+		internalBuffer_ = std::move(buffer);
+		return;
+	}
+
+	data_ = d;
+	for (QHexView *pane : panes_) {
+		pane->setData(data_);
+	}
+
+	internalBuffer_ = nullptr;
+}
+
+/**
+ * sets if scrolling one pane scrolls the others so that they start at the
+ * same address
+ *
+ * @brief QHexSplitView::setLinkScrolling
+ * @param value
+ */
+void QHexSplitView::setLinkScrolling(bool value) {
+	linkScrolling_ = value;
+
+	if (linkScrolling_ && !panes_.empty()) {
+		paneScrolled(panes_.front());
+	}
+}
+
+/**
+ * @brief QHexSplitView::setOrientation
+ * @param orientation Qt::Horizontal for panes side by side, Qt::Vertical for
+ * panes above each other
+ */
+void QHexSplitView::setOrientation(Qt::Orientation orientation) {
+	splitter_->setOrientation(orientation);
+}
+
+/**
+ * @brief QHexSplitView::linkScrolling
+ * @return
+ */
+bool QHexSplitView::linkScrolling() const {
+	return linkScrolling_;
+}
+
+/**
+ * @brief QHexSplitView::paneCount
+ * @return
+ */
+int QHexSplitView::paneCount() const {
+	return static_cast<int>(panes_.size());
+}
+
+/**
+ * @brief QHexSplitView::pane
+ * @param index
+ * @return
+ */
+QHexView *QHexSplitView::pane(int index) const {
+	return panes_[index];
+}
+
+/**
+ * @brief QHexSplitView::selectionModel
+ * @return the selection shared by all of the panes
+ */
+QHexSelectionModel *QHexSplitView::selectionModel() const {
+	return selectionModel_;
+}
+
+/**
+ * scrolls the other panes to the address at the top of the one which was
+ * scrolled, panes with different row sizes will start mid row if they need
+ * to
+ *
+ * @brief QHexSplitView::paneScrolled
+ * @param pane
+ */
+void QHexSplitView::paneScrolled(QHexView *pane) {
+
+	if (!linkScrolling_ || scrolling_ || !data_) {
+		return;
+	}
+
+	scrolling_ = true;
+
+	const QHexView::address_t offset = pane->firstVisibleAddress() - pane->addressOffset();
+	for (QHexView *other : panes_) {
+		if (other != pane) {
+			other->scrollTo(offset);
+		}
+	}
+
+	scrolling_ = false;
+}
@@ -0,0 +1,69 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXSPLITVIEW_H_
+#define QHEXSPLITVIEW_H_
+
+#include <QWidget>
+#include <memory>
+#include <vector>
+
+class QBuffer;
+class QHexSelectionModel;
+class QHexView;
+class QIODevice;
+class QSplitter;
+
+/**
+ * several QHexViews of the same data side by side, for example one showing
+ * bytes next to one showing 8 byte words, or two distant parts of the data.
+ * Each pane is a QHexView which can be set up on its own, but they all read
+ * through the same page cache and share one selection. Scrolling one pane can
+ * optionally scroll the others to the same address
+ */
+class QHexSplitView : public QWidget {
+	Q_OBJECT
+
+public:
+	explicit QHexSplitView(QWidget *parent = nullptr);
+	~QHexSplitView() override;
+
+public:
+	QHexView *addPane();
+	void removePane(QHexView *pane);
+	void setData(QIODevice *d);
+	void setLinkScrolling(bool value);
+	void setOrientation(Qt::Orientation orientation);
+
+public:
+	bool linkScrolling() const;
+	int paneCount() const;
+	QHexView *pane(int index) const;
+	QHexSelectionModel *selectionModel() const;
+
+private:
+	void paneScrolled(QHexView *pane);
+
+private:
+	QSplitter *splitter_                 = nullptr;
+	QHexSelectionModel *selectionModel_ = nullptr; // shared by all of the panes
+	QIODevice *data_                     = nullptr;
+	std::unique_ptr<QBuffer> internalBuffer_;      // holds the data of devices which can't seek
+	std::vector<QHexView *> panes_;
+	bool linkScrolling_ = true;
+	bool scrolling_     = false; // panes are being scrolled to follow another one
+};
+
+#endif
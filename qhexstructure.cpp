@@ -0,0 +1,823 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#include "qhexstructure.h"
+#include "qhexpagecache.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// char arrays show this much of their text
+constexpr int string_preview_length = 32;
+
+// other arrays show this many of their bytes
+constexpr int bytes_preview_length = 16;
+
+struct TypeName {
+	const char *name;
+	QHexStructure::Type type;
+};
+
+constexpr TypeName type_names[] = {
+	{"u8", QHexStructure::UInt8},
+	{"u16", QHexStructure::UInt16},
+	{"u32", QHexStructure::UInt32},
+	{"u64", QHexStructure::UInt64},
+	{"i8", QHexStructure::Int8},
+	{"i16", QHexStructure::Int16},
+	{"i32", QHexStructure::Int32},
+	{"i64", QHexStructure::Int64},
+	{"f32", QHexStructure::Float},
+	{"f64", QHexStructure::Double},
+	{"char", QHexStructure::Char},
+	{"uint8_t", QHexStructure::UInt8},
+	{"uint16_t", QHexStructure::UInt16},
+	{"uint32_t", QHexStructure::UInt32},
+	{"uint64_t", QHexStructure::UInt64},
+	{"int8_t", QHexStructure::Int8},
+	{"int16_t", QHexStructure::Int16},
+	{"int32_t", QHexStructure::Int32},
+	{"int64_t", QHexStructure::Int64},
+	{"float", QHexStructure::Float},
+	{"double", QHexStructure::Double},
+};
+
+/**
+ * @brief is_integer
+ * @param type
+ * @return true if fields of this type can be used as the length of an array
+ */
+bool is_integer(QHexStructure::Type type) {
+	return type != QHexStructure::Float && type != QHexStructure::Double;
+}
+
+/**
+ * splits the source into identifiers, numbers and single character symbols,
+ * skipping whitespace and // comments
+ */
+class Tokenizer {
+public:
+	explicit Tokenizer(const QString &source)
+		: source_(source) {
+		advance();
+	}
+
+public:
+	const QString &token() const { return token_; }
+	bool atEnd() const { return token_.isEmpty(); }
+
+	bool isIdentifier() const {
+		return !atEnd() && (token_[0].isLetter() || token_[0] == QLatin1Char('_'));
+	}
+
+	bool isNumber() const {
+		return !atEnd() && token_[0].isDigit();
+	}
+
+	void advance() {
+		for (;;) {
+			while (position_ < source_.size() && source_[position_].isSpace()) {
+				++position_;
+			}
+
+			if (position_ + 1 >= source_.size() || source_[position_] != QLatin1Char('/') || source_[position_ + 1] != QLatin1Char('/')) {
+				break;
+			}
+
+			while (position_ < source_.size() && source_[position_] != QLatin1Char('\n')) {
+				++position_;
+			}
+		}
+
+		const int start = position_;
+		if (position_ < source_.size()) {
+			if (source_[position_].isLetterOrNumber() || source_[position_] == QLatin1Char('_')) {
+				while (position_ < source_.size() && (source_[position_].isLetterOrNumber() || source_[position_] == QLatin1Char('_'))) {
+					++position_;
+				}
+			} else {
+				++position_;
+			}
+		}
+
+		token_ = source_.mid(start, position_ - start);
+	}
+
+	// consumes the token if it is the expected one
+	bool accept(const char *expected) {
+		if (token_ == QLatin1String(expected)) {
+			advance();
+			return true;
+		}
+		return false;
+	}
+
+private:
+	const QString &source_;
+	QString token_;
+	int position_ = 0;
+};
+
+/**
+ * @brief format_value
+ * @param data the bytes of a single element
+ * @param type
+ * @param big_endian
+ * @param number receives the value of integer types
+ * @return the value formatted for display
+ */
+QString format_value(const uchar *data, QHexStructure::Type type, bool big_endian, int64_t *number) {
+
+	auto load = [&](auto zero) {
+		using T = decltype(zero);
+		return big_endian ? qFromBigEndian<T>(data) : qFromLittleEndian<T>(data);
+	};
+
+	switch (type) {
+	case QHexStructure::UInt8:
+		*number = data[0];
+		return QLatin1String("0x") + QString::number(data[0], 16);
+	case QHexStructure::UInt16:
+		*number = load(quint16());
+		return QLatin1String("0x") + QString::number(load(quint16()), 16);
+	case QHexStructure::UInt32:
+		*number = load(quint32());
+		return QLatin1String("0x") + QString::number(load(quint32()), 16);
+	case QHexStructure::UInt64:
+		*number = static_cast<int64_t>(load(quint64()));
+		return QLatin1String("0x") + QString::number(load(quint64()), 16);
+	case QHexStructure::Int8:
+		*number = static_cast<qint8>(data[0]);
+		return QString::number(*number);
+	case QHexStructure::Int16:
+		*number = load(qint16());
+		return QString::number(*number);
+	case QHexStructure::Int32:
+		*number = load(qint32());
+		return QString::number(*number);
+	case QHexStructure::Int64:
+		*number = load(qint64());
+		return QString::number(*number);
+	case QHexStructure::Char:
+		*number = data[0];
+		if (data[0] >= 0x20 && data[0] < 0x7f) {
+			return QStringLiteral("'%1'").arg(QLatin1Char(static_cast<char>(data[0])));
+		}
+		return QStringLiteral("'\\x%1'").arg(data[0], 2, 16, QLatin1Char('0'));
+	case QHexStructure::Float: {
+		const quint32 bits = load(quint32());
+		float f;
+		std::memcpy(&f, &bits, sizeof(f));
+		return QString::number(f, 'g', 9);
+	}
+	case QHexStructure::Double: {
+		const quint64 bits = load(quint64());
+		double d;
+		std::memcpy(&d, &bits, sizeof(d));
+		return QString::number(d, 'g', 17);
+	}
+	}
+
+	return QString();
+}
+
+/**
+ * @brief load_integer
+ * @param data the bytes of a single element
+ * @param type
+ * @param big_endian
+ * @return the value of an integer type, 0 for the floating point ones
+ */
+int64_t load_integer(const uchar *data, QHexStructure::Type type, bool big_endian) {
+
+	auto load = [&](auto zero) {
+		using T = decltype(zero);
+		return big_endian ? qFromBigEndian<T>(data) : qFromLittleEndian<T>(data);
+	};
+
+	switch (type) {
+	case QHexStructure::UInt8:
+	case QHexStructure::Char:
+		return data[0];
+	case QHexStructure::UInt16:
+		return load(quint16());
+	case QHexStructure::UInt32:
+		return load(quint32());
+	case QHexStructure::UInt64:
+		return static_cast<int64_t>(load(quint64()));
+	case QHexStructure::Int8:
+		return static_cast<qint8>(data[0]);
+	case QHexStructure::Int16:
+		return load(qint16());
+	case QHexStructure::Int32:
+		return load(qint32());
+	case QHexStructure::Int64:
+		return load(qint64());
+	case QHexStructure::Float:
+	case QHexStructure::Double:
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief string_preview
+ * @param data the start of a char array
+ * @param length how much of it there is to show
+ * @param truncated true if the array is longer than that
+ * @return the array as a quoted string, up to the first NUL
+ */
+QString string_preview(const char *data, int length, bool truncated) {
+	QString text = QLatin1String("\"");
+	for (int i = 0; i < length && data[i] != '\0'; ++i) {
+		text += (data[i] >= 0x20 && data[i] < 0x7f) ? QLatin1Char(data[i]) : QLatin1Char('.');
+	}
+	text += truncated ? QLatin1String("\"...") : QLatin1String("\"");
+	return text;
+}
+
+}
+
+/**
+ * replaces the layout with the one described by source
+ *
+ * @brief QHexStructure::parse
+ * @param source
+ * @param error receives a description of the problem if parsing fails
+ * @return true on success, on failure the layout is left unchanged
+ */
+bool QHexStructure::parse(const QString &source, QString *error) {
+
+	Tokenizer tokens(source);
+	QString name;
+	std::vector<Field> fields;
+
+	auto fail = [&](const QString &message) {
+		if (error) {
+			*error = message;
+		}
+		return false;
+	};
+
+	// the struct wrapper is optional, a bare list of fields works too
+	const bool wrapped = tokens.accept("struct");
+	if (wrapped) {
+		if (tokens.isIdentifier()) {
+			name = tokens.token();
+			tokens.advance();
+		}
+
+		if (!tokens.accept("{")) {
+			return fail(QStringLiteral("expected '{' but found '%1'").arg(tokens.token()));
+		}
+	}
+
+	while (!tokens.atEnd() && tokens.token() != QLatin1String("}")) {
+
+		auto type = std::find_if(std::begin(type_names), std::end(type_names), [&](const TypeName &entry) {
+			return tokens.token() == QLatin1String(entry.name);
+		});
+
+		if (type == std::end(type_names)) {
+			return fail(QStringLiteral("unknown type '%1'").arg(tokens.token()));
+		}
+
+		tokens.advance();
+
+		Field field;
+		field.type = type->type;
+
+		if (!tokens.isIdentifier()) {
+			return fail(QStringLiteral("expected a field name but found '%1'").arg(tokens.token()));
+		}
+
+		field.name = tokens.token();
+		tokens.advance();
+
+		if (tokens.accept("[")) {
+			field.array = true;
+
+			if (tokens.isNumber()) {
+				bool ok;
+				field.count = tokens.token().toLongLong(&ok, 0);
+				if (!ok || field.count < 0) {
+					return fail(QStringLiteral("invalid array length '%1'").arg(tokens.token()));
+				}
+			} else if (tokens.isIdentifier()) {
+				auto length = std::find_if(fields.begin(), fields.end(), [&](const Field &earlier) {
+					return earlier.name == tokens.token();
+				});
+
+				if (length == fields.end() || length->array || !is_integer(length->type)) {
+					return fail(QStringLiteral("the length of '%1' must be an earlier integer field").arg(field.name));
+				}
+
+				field.countField = static_cast<int>(length - fields.begin());
+			} else {
+				return fail(QStringLiteral("expected an array length but found '%1'").arg(tokens.token()));
+			}
+
+			tokens.advance();
+
+			if (!tokens.accept("]")) {
+				return fail(QStringLiteral("expected ']' but found '%1'").arg(tokens.token()));
+			}
+		}
+
+		if (!tokens.accept(";")) {
+			return fail(QStringLiteral("expected ';' after '%1'").arg(field.name));
+		}
+
+		fields.push_back(std::move(field));
+	}
+
+	if (wrapped) {
+		if (!tokens.accept("}")) {
+			return fail(QStringLiteral("expected '}'"));
+		}
+
+		tokens.accept(";");
+	}
+
+	if (!tokens.atEnd()) {
+		return fail(QStringLiteral("unexpected '%1'").arg(tokens.token()));
+	}
+
+	if (fields.empty()) {
+		return fail(QStringLiteral("the structure has no fields"));
+	}
+
+	name_   = name;
+	fields_ = std::move(fields);
+	return true;
+}
+
+/**
+ * @brief QHexStructure::typeSize
+ * @param type
+ * @return the size of a single element of the given type in bytes
+ */
+int QHexStructure::typeSize(Type type) {
+	switch (type) {
+	case UInt8:
+	case Int8:
+	case Char:
+		return 1;
+	case UInt16:
+	case Int16:
+		return 2;
+	case UInt32:
+	case Int32:
+	case Float:
+		return 4;
+	case UInt64:
+	case Int64:
+	case Double:
+		return 8;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief QHexStructure::fieldOffset
+ * @param field
+ * @return where the field starts within a record, only meaningful when the
+ * layout has a fixed size
+ */
+int64_t QHexStructure::fieldOffset(int field) const {
+	int64_t offset = 0;
+	for (int i = 0; i < field; ++i) {
+		offset += fieldSize(i);
+	}
+	return offset;
+}
+
+/**
+ * @brief QHexStructure::fieldSize
+ * @param field
+ * @return the size of the field in bytes, only meaningful when the layout has
+ * a fixed size
+ */
+int64_t QHexStructure::fieldSize(int field) const {
+	return fields_[field].count * typeSize(fields_[field].type);
+}
+
+/**
+ * formats a field of a fixed size record, for when its bytes are already at
+ * hand
+ *
+ * @brief QHexStructure::format
+ * @param field
+ * @param data the bytes of the field
+ * @param size the number of bytes at data, less than the size of the field if
+ * the record is cut short
+ * @param big_endian
+ * @return the value of the field as it is shown to the user
+ */
+QString QHexStructure::format(int field, const char *data, int64_t size, bool big_endian) const {
+
+	const Field &f = fields_[field];
+
+	if (!f.array) {
+		int64_t number;
+		return (size >= typeSize(f.type)) ? format_value(reinterpret_cast<const uchar *>(data), f.type, big_endian, &number) : QString();
+	}
+
+	if (f.type == Char) {
+		const int preview = static_cast<int>(std::min<int64_t>(size, string_preview_length));
+		return string_preview(data, preview, fieldSize(field) > preview);
+	}
+
+	static constexpr char digits[] = "0123456789abcdef";
+
+	const int preview = static_cast<int>(std::min<int64_t>(size, bytes_preview_length));
+
+	QString text;
+	for (int i = 0; i < preview; ++i) {
+		if (i != 0) {
+			text += QLatin1Char(' ');
+		}
+		text += QLatin1Char(digits[(data[i] >> 4) & 0x0f]);
+		text += QLatin1Char(digits[data[i] & 0x0f]);
+	}
+
+	if (fieldSize(field) > preview) {
+		text += QLatin1String(" ...");
+	}
+
+	return text;
+}
+
+/**
+ * @brief QHexStructure::fixedSize
+ * @return the size of every record, or -1 if it depends on the data
+ */
+int64_t QHexStructure::fixedSize() const {
+	int64_t size = 0;
+	for (const Field &field : fields_) {
+		if (field.countField != -1) {
+			return -1;
+		}
+		size += field.count * typeSize(field.type);
+	}
+	return size;
+}
+
+/**
+ * reads the record at the given offset. A record which runs past the end of
+ * the data is cut short
+ *
+ * @brief QHexStructure::evaluate
+ * @param cache
+ * @param offset
+ * @param big_endian
+ * @return
+ */
+auto QHexStructure::evaluate(QHexPageCache *cache, int64_t offset, bool big_endian) const -> Record {
+
+	Record record;
+	std::vector<int64_t> numbers(fields_.size(), 0);
+
+	const int64_t data_size = cache->size();
+	int64_t position        = offset;
+
+	for (size_t i = 0; i < fields_.size() && position < data_size; ++i) {
+		const Field &field = fields_[i];
+
+		int64_t count = field.count;
+		if (field.countField != -1) {
+			count = std::max<int64_t>(numbers[field.countField], 0);
+		}
+
+		const int element_size  = typeSize(field.type);
+		const int64_t remaining = data_size - position;
+		const int64_t size      = std::min(std::min(count, remaining) * element_size, remaining);
+
+		Value value;
+		value.field  = static_cast<int>(i);
+		value.offset = position;
+		value.size   = size;
+
+		if (!field.array) {
+			uchar data[sizeof(quint64)] = {};
+			if (size == element_size && cache->read(position, reinterpret_cast<char *>(data), size) == size) {
+				value.text = field.name + QLatin1String(" = ") + format_value(data, field.type, big_endian, &numbers[i]);
+			} else {
+				value.text = field.name;
+			}
+		} else if (field.type == Char) {
+			// show the start of the text, like a debugger would
+			char data[string_preview_length];
+			int preview = static_cast<int>(std::min<int64_t>(size, string_preview_length));
+
+			if (cache->read(position, data, preview) != preview) {
+				preview = 0;
+			}
+
+			value.text = field.name + QLatin1String(" = ") + string_preview(data, preview, size > preview);
+		} else {
+			value.text = field.name + QLatin1Char('[') + QString::number(count) + QLatin1Char(']');
+		}
+
+		record.values.push_back(std::move(value));
+		position += size;
+	}
+
+	record.size = position - offset;
+	return record;
+}
+
+/**
+ * finds the size evaluate() would give the record at the given offset, only
+ * reading the fields which hold the length of an array
+ *
+ * @brief QHexStructure::measure
+ * @param cache
+ * @param offset
+ * @param big_endian
+ * @return
+ */
+int64_t QHexStructure::measure(QHexPageCache *cache, int64_t offset, bool big_endian) const {
+
+	std::vector<int64_t> numbers(fields_.size(), 0);
+	std::vector<bool> counts(fields_.size(), false);
+	for (const Field &field : fields_) {
+		if (field.countField != -1) {
+			counts[field.countField] = true;
+		}
+	}
+
+	const int64_t data_size = cache->size();
+	int64_t position        = offset;
+
+	for (size_t i = 0; i < fields_.size() && position < data_size; ++i) {
+		const Field &field = fields_[i];
+
+		int64_t count = field.count;
+		if (field.countField != -1) {
+			count = std::max<int64_t>(numbers[field.countField], 0);
+		}
+
+		const int element_size  = typeSize(field.type);
+		const int64_t remaining = data_size - position;
+		const int64_t size      = std::min(std::min(count, remaining) * element_size, remaining);
+
+		if (counts[i] && !field.array) {
+			uchar data[sizeof(quint64)] = {};
+			if (size == element_size && cache->read(position, reinterpret_cast<char *>(data), size) == size) {
+				numbers[i] = load_integer(data, field.type, big_endian);
+			}
+		}
+
+		position += size;
+	}
+
+	return position - offset;
+}
+
+/**
+ * @brief QHexStructureOverlay::QHexStructureOverlay
+ * @param structure
+ * @param offset where the first record starts
+ * @param count the number of records
+ */
+QHexStructureOverlay::QHexStructureOverlay(QHexStructure structure, int64_t offset, int64_t count)
+	: structure_(std::move(structure)), offset_(offset), count_(count), fixedSize_(structure_.fixedSize()) {
+	invalidate();
+}
+
+/**
+ * forgets everything which was read, for when the data or the way it is
+ * interpreted changes
+ *
+ * @brief QHexStructureOverlay::invalidate
+ */
+void QHexStructureOverlay::invalidate() {
+	cache_.clear();
+	checkpoints_.assign(1, offset_);
+	known_        = 0;
+	knownOffset_  = offset_;
+	cursor_       = 0;
+	cursorOffset_ = offset_;
+	complete_     = fixedSize_ != -1 || count_ <= 0;
+	waiting_      = false;
+}
+
+/**
+ * for when the data grows. What was found so far stays, except records
+ * which reached the old end of the data and so may have been cut short by
+ * it. Records after them are found by carrying on from there
+ *
+ * @brief QHexStructureOverlay::grow
+ * @param old_size the size of the data before it grew
+ */
+void QHexStructureOverlay::grow(int64_t old_size) {
+	for (auto it = cache_.begin(); it != cache_.end();) {
+		const std::vector<QHexStructure::Value> &values = it->values;
+		if (values.empty() || values.back().offset + values.back().size >= old_size) {
+			it = cache_.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+/**
+ * measures the next slice of the records which are still to be found, called
+ * whenever the event loop is idle until it returns true
+ *
+ * @brief QHexStructureOverlay::scan
+ * @param cache
+ * @param big_endian
+ * @return true if every record there is has been found, more may turn up if
+ * the data grows
+ */
+bool QHexStructureOverlay::scan(QHexPageCache *cache, bool big_endian) {
+	waiting_ = false;
+	return extend(cache, big_endian, ScanSliceRecords);
+}
+
+/**
+ * finds where up to the given number of records after the last one found
+ * so far start
+ *
+ * @brief QHexStructureOverlay::extend
+ * @param cache
+ * @param big_endian
+ * @param records
+ * @return true if there are no more records to find
+ */
+bool QHexStructureOverlay::extend(QHexPageCache *cache, bool big_endian, int64_t records) {
+
+	// a record which is empty or cut short by the end of the data is the
+	// last, though the data may grow past it later
+	for (; records > 0 && !complete_; --records) {
+		if (known_ + 1 >= count_) {
+			complete_ = true;
+			break;
+		}
+
+		const int64_t length = structure_.measure(cache, knownOffset_, big_endian);
+		if (length == 0) {
+			complete_ = true;
+			break;
+		}
+
+		if (knownOffset_ + length >= cache->size()) {
+			return true;
+		}
+
+		++known_;
+		knownOffset_ += length;
+
+		if (known_ % CheckpointSpacing == 0) {
+			checkpoints_.push_back(knownOffset_);
+		}
+	}
+
+	return complete_;
+}
+
+/**
+ * @brief QHexStructureOverlay::locate
+ * @param cache
+ * @param index
+ * @param big_endian
+ * @param offset receives where the record starts
+ * @return true if there is such a record
+ */
+bool QHexStructureOverlay::locate(QHexPageCache *cache, int64_t index, bool big_endian, int64_t *offset) {
+
+	if (index < 0 || index >= count_) {
+		return false;
+	}
+
+	if (fixedSize_ != -1) {
+		*offset = offset_ + index * fixedSize_;
+		return *offset < cache->size() && (fixedSize_ != 0 || index == 0);
+	}
+
+	if (index > known_) {
+		extend(cache, big_endian, std::min(index - known_, ScanSliceRecords));
+		if (index > known_) {
+			waiting_ = !complete_;
+			return false;
+		}
+	}
+
+	// start from the nearest checkpoint, or from the last lookup if that is
+	// nearer, so walking through the records in order measures each only once
+	int64_t current = index - index % CheckpointSpacing;
+	int64_t start   = checkpoints_[current / CheckpointSpacing];
+	if (cursor_ <= index && cursor_ > current) {
+		current = cursor_;
+		start   = cursorOffset_;
+	}
+
+	for (; current < index; ++current) {
+		start += structure_.measure(cache, start, big_endian);
+	}
+
+	cursor_       = index;
+	cursorOffset_ = start;
+	*offset       = start;
+	return true;
+}
+
+/**
+ * @brief QHexStructureOverlay::record
+ * @param cache
+ * @param index
+ * @param offset where the record starts
+ * @param big_endian
+ * @return the record, read if it isn't cached
+ */
+const QHexStructure::Record &QHexStructureOverlay::record(QHexPageCache *cache, int64_t index, int64_t offset, bool big_endian) {
+
+	auto it = cache_.find(index);
+	if (it == cache_.end()) {
+		if (cache_.size() >= MaxCachedRecords) {
+			cache_.clear();
+		}
+
+		it = cache_.insert(index, structure_.evaluate(cache, offset, big_endian));
+	}
+
+	return *it;
+}
+
+/**
+ * @brief QHexStructureOverlay::recordAt
+ * @param cache
+ * @param offset
+ * @param big_endian
+ * @return the index of the record which contains the byte at offset, or of
+ * the first record if offset is before it, -1 if there is no such record or
+ * it hasn't been found yet
+ */
+int64_t QHexStructureOverlay::recordAt(QHexPageCache *cache, int64_t offset, bool big_endian) {
+
+	if (offset <= offset_) {
+		return 0;
+	}
+
+	if (fixedSize_ != -1) {
+		return (fixedSize_ != 0) ? std::min((offset - offset_) / fixedSize_, count_) : 0;
+	}
+
+	// only a slice more is measured, the rest is left to scan()
+	if (knownOffset_ <= offset) {
+		bool done = complete_;
+		for (int64_t budget = ScanSliceRecords; knownOffset_ <= offset && !done; --budget) {
+			if (budget == 0) {
+				waiting_ = true;
+				return -1;
+			}
+			done = extend(cache, big_endian, 1);
+		}
+
+		if (knownOffset_ <= offset) {
+			return known_;
+		}
+	}
+
+	auto it         = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset);
+	int64_t current = static_cast<int64_t>(it - checkpoints_.begin() - 1) * CheckpointSpacing;
+	int64_t start   = checkpoints_[current / CheckpointSpacing];
+	if (cursor_ > current && cursor_ <= known_ && cursorOffset_ <= offset) {
+		current = cursor_;
+		start   = cursorOffset_;
+	}
+
+	while (current < known_) {
+		const int64_t length = structure_.measure(cache, start, big_endian);
+		if (start + length > offset) {
+			break;
+		}
+
+		start += length;
+		++current;
+	}
+
+	cursor_       = current;
+	cursorOffset_ = start;
+	return current;
+}
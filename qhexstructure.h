@@ -0,0 +1,167 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXSTRUCTURE_H_
+#define QHEXSTRUCTURE_H_
+
+#include <QHash>
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+class QHexPageCache;
+
+/**
+ * a record layout written in a small C like language, for example:
+ *
+ *     struct hdr {
+ *         u32 magic;
+ *         u16 count;
+ *         u8 data[count];
+ *     };
+ *
+ * The types are u8, u16, u32, u64, i8, i16, i32, i64, f32, f64 and char (or
+ * their <cstdint> names, float and double). Arrays have either a constant
+ * length or the name of an earlier integer field holding the length
+ */
+class QHexStructure {
+public:
+	enum Type {
+		UInt8,
+		UInt16,
+		UInt32,
+		UInt64,
+		Int8,
+		Int16,
+		Int32,
+		Int64,
+		Float,
+		Double,
+		Char
+	};
+
+	struct Field {
+		QString name;
+		Type type;
+		bool array     = false;
+		int64_t count  = 1;  // number of elements when countField is -1
+		int countField = -1; // index of the earlier field holding the number of elements
+	};
+
+	// a field of a record which has been read
+	struct Value {
+		int field;      // index into fields()
+		int64_t offset; // of the first byte
+		int64_t size;   // in bytes
+		QString text;   // as it is shown to the user
+	};
+
+	struct Record {
+		int64_t size = 0;
+		std::vector<Value> values;
+	};
+
+public:
+	bool parse(const QString &source, QString *error = nullptr);
+
+public:
+	const QString &name() const { return name_; }
+	const std::vector<Field> &fields() const { return fields_; }
+	int64_t fieldOffset(int field) const;
+	int64_t fieldSize(int field) const;
+	int64_t fixedSize() const;
+	QString format(int field, const char *data, int64_t size, bool big_endian) const;
+	Record evaluate(QHexPageCache *cache, int64_t offset, bool big_endian) const;
+	int64_t measure(QHexPageCache *cache, int64_t offset, bool big_endian) const;
+
+public:
+	static int typeSize(Type type);
+
+private:
+	QString name_;
+	std::vector<Field> fields_;
+};
+
+/**
+ * a structure applied to the data as an array of records. Records are only
+ * read when something asks about the bytes they cover, and are cached once
+ * read. When records vary in size, finding one means finding the end of the
+ * ones before it, so they are measured once, a slice at a time, and the start
+ * of every CheckpointSpacing'th record is kept as a checkpoint. Lookups start
+ * from the nearest checkpoint at or before them, or carry on from where the
+ * previous one ended. A lookup past what has been measured so far only
+ * measures a slice more, see scan() for finding the rest when idle
+ */
+class QHexStructureOverlay {
+public:
+	QHexStructureOverlay(QHexStructure structure, int64_t offset, int64_t count);
+
+public:
+	void invalidate();
+	void grow(int64_t old_size);
+	bool scan(QHexPageCache *cache, bool big_endian);
+	bool isWaiting() const { return waiting_; }
+
+	/**
+	 * calls func with every value of every record which overlaps the bytes
+	 * [start, end)
+	 */
+	template <class Func>
+	void query(QHexPageCache *cache, int64_t start, int64_t end, bool big_endian, Func func) {
+
+		for (int64_t index = recordAt(cache, start, big_endian); index != -1; ++index) {
+
+			int64_t record_offset;
+			if (!locate(cache, index, big_endian, &record_offset) || record_offset >= end) {
+				break;
+			}
+
+			for (const QHexStructure::Value &value : record(cache, index, record_offset, big_endian).values) {
+				if (value.offset < end && value.offset + value.size > start) {
+					func(value);
+				}
+			}
+		}
+	}
+
+private:
+	bool extend(QHexPageCache *cache, bool big_endian, int64_t records);
+	bool locate(QHexPageCache *cache, int64_t index, bool big_endian, int64_t *offset);
+	const QHexStructure::Record &record(QHexPageCache *cache, int64_t index, int64_t offset, bool big_endian);
+	int64_t recordAt(QHexPageCache *cache, int64_t offset, bool big_endian);
+
+private:
+	// records are read again rather than letting the cache grow past this
+	static constexpr int MaxCachedRecords = 4096;
+
+	// records between checkpoints, and the most records measured in one go
+	static constexpr int64_t CheckpointSpacing = 1024;
+	static constexpr int64_t ScanSliceRecords  = 64 * 1024;
+
+	QHexStructure structure_;
+	int64_t offset_;
+	int64_t count_;
+	int64_t fixedSize_;                           // size of every record, or -1 if it depends on the data
+	std::vector<int64_t> checkpoints_;            // start of every CheckpointSpacing'th record found so far
+	int64_t known_        = 0;                    // the last record whose start has been found
+	int64_t knownOffset_  = 0;                    // where it starts
+	int64_t cursor_       = 0;                    // the record the last lookup found
+	int64_t cursorOffset_ = 0;                    // where it starts
+	bool complete_        = false;                // known_ is the last record there is
+	bool waiting_         = false;                // a lookup stopped at records which are still to be found
+	QHash<int64_t, QHexStructure::Record> cache_; // records by index
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+Copyright (C) 2006 - 2013 Evan Teran
+						  eteran@alum.rit.edu
+
+Copyright (C) 2010        Hugues Bruant
+						  hugues.bruant@gmail.com
+
+This file can be used under one of two licenses.
+
+1. The GNU Public License, version 2.0, in COPYING-gpl2
+2. A BSD-Style License, in COPYING-bsd2.
+
+The license chosen is at the discretion of the user of this software.
+*/
+
+#ifndef QHEXTEXTDECODER_H_
+#define QHEXTEXTDECODER_H_
+
+#include "qhexview.h"
+#include <cstdint>
+
+/**
+ * decodes raw bytes into the characters displayed in the text column. Every
+ * input byte produces exactly one output code point, so that the text column
+ * stays aligned with the data column. Multi-byte characters are reported at
+ * the position of their first byte, the remaining bytes are marked as
+ * continuations
+ */
+class QHexTextDecoder {
+public:
+	static constexpr char32_t Unprintable  = 0;          // the byte does not start a printable character
+	static constexpr char32_t Continuation = 0xffffffff; // the byte belongs to a character which started earlier
+
+public:
+	explicit QHexTextDecoder(QHexView::TextEncoding encoding);
+
+public:
+	void decode(const uint8_t *data, int size, char32_t *out) const;
+
+private:
+	void decodeUtf8(const uint8_t *data, int size, char32_t *out) const;
+	void decodeUtf16(const uint8_t *data, int size, char32_t *out) const;
+
+private:
+	QHexView::TextEncoding encoding_;
+	const char16_t *table_; // byte to character table, also used for the ascii subset of unicode encodings
+};
+
+#endif
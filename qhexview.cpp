@@ -14,44 +14,494 @@ The license chosen is at the discretion of the user of this software.
 */
 
 #include "qhexview.h"
+#include "qhexfilecopy.h"
+#ifdef QHEXVIEW_HAVE_ZLIB
+#include "qhexgzipdevice.h"
+#endif
+#include "qhexpagecache.h"
+#include "qhexregiondevice.h"
+#include "qhexsparsefiledevice.h"
+#include "qhextextdecoder.h"
 
 #include <QApplication>
 #include <QClipboard>
 #include <QDebug>
+#include <QFile>
+#include <QFileDialog>
 #include <QFontDialog>
 #include <QMenu>
+#include <QMessageBox>
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPalette>
 #include <QPixmap>
 #include <QScrollBar>
+#include <QTimer>
 #include <QStringBuilder>
 #include <QTextStream>
+#include <QVarLengthArray>
 #include <QtEndian>
 #include <QtGlobal>
 
+#include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <climits>
 #include <cmath>
 #include <memory>
 
 namespace {
 
+using row_formatter_t = void (*)(const uint8_t *data, int count, char *out);
+
+/**
+ * the tables below are generated at compile time, they map a value to its
+ * fixed width textual representation so that the formatters can emit
+ * several digits with a single copy
+ */
+struct BinaryTable {
+	char digits[256 * 8];
+};
+
+struct OctalTable {
+	char digits[64 * 2];
+};
+
+struct DecimalTable {
+	char digits[100 * 2];
+};
+
+constexpr BinaryTable make_binary_table() {
+	BinaryTable table = {};
+	for (int i = 0; i < 256; ++i) {
+		for (int bit = 0; bit < 8; ++bit) {
+			table.digits[i * 8 + bit] = (i & (0x80 >> bit)) ? '1' : '0';
+		}
+	}
+	return table;
+}
+
+constexpr OctalTable make_octal_table() {
+	OctalTable table = {};
+	for (int i = 0; i < 64; ++i) {
+		table.digits[i * 2 + 0] = static_cast<char>('0' + (i >> 3));
+		table.digits[i * 2 + 1] = static_cast<char>('0' + (i & 7));
+	}
+	return table;
+}
+
+constexpr DecimalTable make_decimal_table() {
+	DecimalTable table = {};
+	for (int i = 0; i < 100; ++i) {
+		table.digits[i * 2 + 0] = static_cast<char>('0' + (i / 10));
+		table.digits[i * 2 + 1] = static_cast<char>('0' + (i % 10));
+	}
+	return table;
+}
+
+constexpr BinaryTable binary_bytes   = make_binary_table();
+constexpr OctalTable octal_pairs     = make_octal_table();
+constexpr DecimalTable decimal_pairs = make_decimal_table();
+
+/**
+ * the QHexView::ByteClass of every byte value, so that coloring a byte is a
+ * table lookup rather than a series of tests
+ */
+struct ByteClassTable {
+	uint8_t classes[256];
+};
+
+constexpr ByteClassTable make_byte_class_table() {
+	ByteClassTable table = {};
+	for (int i = 0; i < 256; ++i) {
+		if (i == 0x00) {
+			table.classes[i] = QHexView::NullByte;
+		} else if (i == 0xff) {
+			table.classes[i] = QHexView::FullByte;
+		} else if (i == ' ' || (i >= '\t' && i <= '\r')) {
+			table.classes[i] = QHexView::WhitespaceByte;
+		} else if (i < 0x20 || i == 0x7f) {
+			table.classes[i] = QHexView::ControlByte;
+		} else if (i < 0x7f) {
+			table.classes[i] = QHexView::PrintableByte;
+		} else {
+			table.classes[i] = QHexView::HighBitByte;
+		}
+	}
+	return table;
+}
+
+constexpr ByteClassTable byte_classes = make_byte_class_table();
+
+/**
+ * @brief word_class
+ * @param word
+ * @param width
+ * @return the class shared by every byte of the word, or
+ * QHexView::ByteClassCount if they differ
+ */
+int word_class(const uint8_t *word, int width) {
+	const int first = byte_classes.classes[word[0]];
+	for (int i = 1; i < width; ++i) {
+		if (byte_classes.classes[word[i]] != first) {
+			return QHexView::ByteClassCount;
+		}
+	}
+	return first;
+}
+
+/**
+ * @brief display_char
+ * @param ch a character produced by QHexTextDecoder
+ * @return the character to show for ch in the text column, control
+ * characters (whitespace included) would break up the column, so they are
+ * shown the same as bytes which have no representation at all
+ */
+constexpr char32_t display_char(char32_t ch) {
+	return (ch < 0x20) ? QHexTextDecoder::Unprintable : ch;
+}
+
+// how much data is looked at for repeated rows each time the event loop is
+// idle, small enough to not be noticed
+constexpr int64_t repeat_scan_bytes = 4 * 1024 * 1024;
+
+// shading for the fields of a structure, by field index
+constexpr QRgb structure_colors[] = {0xffd8e8ff, 0xffffe0c0, 0xffd8f5d8, 0xfff0d8f0};
+
 /**
- * determines if a character has a printable ascii symbol
+ * loads a word stored most significant byte first into a pair of 64-bit
+ * halves, words of up to 8 bytes only use the low half
  *
- * @brief is_printable
- * @param ch
- * @return
+ * @brief load_word
+ * @param word
+ * @param hi
+ * @param lo
+ */
+template <int Width>
+void load_word(const uint8_t *word, uint64_t *hi, uint64_t *lo) {
+	uint64_t h = 0;
+	uint64_t l = 0;
+	for (int i = 0; i < Width; ++i) {
+		if (Width - i > 8) {
+			h = (h << 8) | word[i];
+		} else {
+			l = (l << 8) | word[i];
+		}
+	}
+	*hi = h;
+	*lo = l;
+}
+
+/**
+ * @brief extract_bits
+ * @param hi
+ * @param lo
+ * @param pos
+ * @param n
+ * @return the |n| bits starting at bit |pos| of the 128-bit value hi:lo
+ */
+constexpr uint64_t extract_bits(uint64_t hi, uint64_t lo, int pos, int n) {
+	const uint64_t mask = (uint64_t(1) << n) - 1;
+	if (pos >= 64) {
+		return (hi >> (pos - 64)) & mask;
+	}
+
+	if (pos + n <= 64) {
+		return (lo >> pos) & mask;
+	}
+
+	return ((lo >> pos) | (hi << (64 - pos))) & mask;
+}
+
+/**
+ * writes the decimal representation of the 128-bit value hi:lo backwards,
+ * ending just before |end|
+ *
+ * @brief write_decimal
+ * @param hi
+ * @param lo
+ * @param end
+ * @return a pointer to the first digit written
+ */
+char *write_decimal(uint64_t hi, uint64_t lo, char *end) {
+
+	char *const last = end;
+
+	// while the value doesn't fit into 64-bits, peel off 9 digits at a time by
+	// dividing the value, as four 32-bit limbs, by 10^9
+	while (hi != 0) {
+		uint32_t limbs[4] = {
+			static_cast<uint32_t>(hi >> 32),
+			static_cast<uint32_t>(hi),
+			static_cast<uint32_t>(lo >> 32),
+			static_cast<uint32_t>(lo),
+		};
+
+		uint64_t remainder = 0;
+		for (uint32_t &limb : limbs) {
+			const uint64_t current = (remainder << 32) | limb;
+			limb                   = static_cast<uint32_t>(current / 1000000000);
+			remainder              = current % 1000000000;
+		}
+
+		hi = (static_cast<uint64_t>(limbs[0]) << 32) | limbs[1];
+		lo = (static_cast<uint64_t>(limbs[2]) << 32) | limbs[3];
+
+		for (int i = 0; i < 9; ++i) {
+			*--end = static_cast<char>('0' + (remainder % 10));
+			remainder /= 10;
+		}
+	}
+
+	while (lo >= 100) {
+		end -= 2;
+		memcpy(end, &decimal_pairs.digits[(lo % 100) * 2], 2);
+		lo /= 100;
+	}
+
+	if (lo >= 10) {
+		end -= 2;
+		memcpy(end, &decimal_pairs.digits[lo * 2], 2);
+	} else if (lo != 0 || end == last) {
+		*--end = static_cast<char>('0' + lo);
+	}
+
+	return end;
+}
+
+/**
+ * Each radix below knows how many characters a word of a given width takes
+ * up and how to format one word, presented most significant byte first.
+ * Numeric radices are zero padded, decimal ones are right aligned
+ */
+struct HexRadix {
+	static constexpr int chars(int width) {
+		return width * 2;
+	}
+
+	template <int Width>
+	static char *format(const uint8_t *word, char *out) {
+		for (int i = 0; i < Width; ++i) {
+			memcpy(out, &QHexCodec::HexPairs[word[i] * 2], 2);
+			out += 2;
+		}
+		return out;
+	}
+};
+
+struct BinaryRadix {
+	static constexpr int chars(int width) {
+		return width * 8;
+	}
+
+	template <int Width>
+	static char *format(const uint8_t *word, char *out) {
+		for (int i = 0; i < Width; ++i) {
+			memcpy(out, &binary_bytes.digits[word[i] * 8], 8);
+			out += 8;
+		}
+		return out;
+	}
+};
+
+struct OctalRadix {
+	static constexpr int chars(int width) {
+		return (width * 8 + 2) / 3;
+	}
+
+	template <int Width>
+	static char *format(const uint8_t *word, char *out) {
+		uint64_t hi;
+		uint64_t lo;
+		load_word<Width>(word, &hi, &lo);
+
+		int digit = chars(Width);
+		if (digit & 1) {
+			--digit;
+			*out++ = static_cast<char>('0' + extract_bits(hi, lo, digit * 3, 3));
+		}
+
+		while (digit != 0) {
+			digit -= 2;
+			memcpy(out, &octal_pairs.digits[extract_bits(hi, lo, digit * 3, 6) * 2], 2);
+			out += 2;
+		}
+		return out;
+	}
+};
+
+struct UnsignedDecimalRadix {
+	static constexpr int chars(int width) {
+		switch (width) {
+		case 1:
+			return 3;
+		case 2:
+			return 5;
+		case 4:
+			return 10;
+		case 8:
+			return 20;
+		default:
+			return 39;
+		}
+	}
+
+	template <int Width>
+	static char *format(const uint8_t *word, char *out) {
+		uint64_t hi;
+		uint64_t lo;
+		load_word<Width>(word, &hi, &lo);
+
+		char *const end = out + chars(Width);
+		char *first     = write_decimal(hi, lo, end);
+		while (first != out) {
+			*--first = ' ';
+		}
+		return end;
+	}
+};
+
+struct SignedDecimalRadix {
+	static constexpr int chars(int width) {
+		// the most negative value of a 64-bit word has one digit less than
+		// the largest unsigned one, so the sign fits in the same space
+		return width == 8 ? 20 : UnsignedDecimalRadix::chars(width) + 1;
+	}
+
+	template <int Width>
+	static char *format(const uint8_t *word, char *out) {
+		uint64_t hi;
+		uint64_t lo;
+		load_word<Width>(word, &hi, &lo);
+
+		const bool negative = (word[0] & 0x80) != 0;
+		if (negative) {
+			// sign extend to 128-bits, then negate to get the magnitude
+			if (Width < 8) {
+				lo |= ~uint64_t(0) << (Width * 8);
+			}
+
+			if (Width <= 8) {
+				hi = ~uint64_t(0);
+			} else if (Width < 16) {
+				hi |= ~uint64_t(0) << ((Width - 8) * 8);
+			}
+
+			lo = ~lo + 1;
+			hi = ~hi + (lo == 0 ? 1 : 0);
+		}
+
+		char *const end = out + chars(Width);
+		char *first     = write_decimal(hi, lo, end);
+		if (negative) {
+			*--first = '-';
+		}
+
+		while (first != out) {
+			*--first = ' ';
+		}
+		return end;
+	}
+};
+
+/**
+ * IEEE-754 float and double, using the shortest representation which round
+ * trips back to the same value. NaN and infinities get fixed markers
  */
-constexpr bool is_printable(uint8_t ch) {
+template <class T>
+struct FloatRadix {
+	static constexpr int chars(int width) {
+		// sign, 9 or 17 significant digits, decimal point and exponent
+		Q_UNUSED(width)
+		return sizeof(T) == sizeof(float) ? 15 : 24;
+	}
+
+	template <int Width>
+	static char *format(const uint8_t *word, char *out) {
+		static_assert(Width == sizeof(T), "word width must match the floating point type");
+
+		uint64_t hi;
+		uint64_t lo;
+		load_word<Width>(word, &hi, &lo);
+		Q_UNUSED(hi)
+
+		T value;
+		if constexpr (sizeof(T) == sizeof(uint32_t)) {
+			const auto bits = static_cast<uint32_t>(lo);
+			memcpy(&value, &bits, sizeof(value));
+		} else {
+			memcpy(&value, &lo, sizeof(value));
+		}
+
+		char buffer[32];
+		const char *first = buffer;
+		const char *last  = buffer;
+
+		if (std::isnan(value)) {
+			first = "NaN";
+			last  = first + 3;
+		} else if (std::isinf(value)) {
+			first = std::signbit(value) ? "-Inf" : "+Inf";
+			last  = first + 4;
+		} else {
+			last = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+		}
 
-	// if it's standard ascii use isprint/isspace, otherwise go with our observations
-	if (ch < 0x80) {
-		return std::isprint(ch) || std::isspace(ch);
+		char *const end = out + chars(Width);
+		const auto n    = static_cast<int>(last - first);
+		memset(out, ' ', chars(Width) - n);
+		memcpy(end - n, first, n);
+		return end;
 	}
+};
 
-	return (ch & 0xff) >= 0xa0;
+/**
+ * formats |count| words of |Width| bytes each using |Radix|. When |Reverse|
+ * is set, the bytes of each word are read in reverse order, which displays
+ * little endian data most significant byte first. The word width is a
+ * compile time constant, so the inner loop has no branches and is fully
+ * unrolled
+ *
+ * @brief format_words
+ * @param data
+ * @param count
+ * @param out
+ */
+template <class Radix, int Width, bool Reverse>
+void format_words(const uint8_t *data, int count, char *out) {
+	for (int i = 0; i < count; ++i) {
+		uint8_t word[Width];
+		for (int j = 0; j < Width; ++j) {
+			word[j] = data[Reverse ? (Width - 1 - j) : j];
+		}
+
+		out = Radix::template format<Width>(word, out);
+		data += Width;
+	}
+}
+
+/**
+ * @brief select_formatter
+ * @param wordWidth
+ * @return the instantiation of format_words for the given word width
+ */
+template <class Radix, bool Reverse>
+row_formatter_t select_formatter(int wordWidth) {
+	switch (wordWidth) {
+	case 1:
+		return format_words<Radix, 1, Reverse>;
+	case 2:
+		return format_words<Radix, 2, Reverse>;
+	case 4:
+		return format_words<Radix, 4, Reverse>;
+	case 8:
+		return format_words<Radix, 8, Reverse>;
+	case 16:
+		return format_words<Radix, 16, Reverse>;
+	default:
+		Q_ASSERT(0);
+		return format_words<Radix, 1, Reverse>;
+	}
 }
 
 /**
@@ -89,6 +539,18 @@ QHexView::QHexView(QWidget *parent)
 	addressSize_ = Address64;
 #endif
 
+	scratch_.row.reserve(MaxBytesPerRow);
+
+	repeatIndexTimer_ = new QTimer(this);
+	connect(repeatIndexTimer_, &QTimer::timeout, this, &QHexView::scanRepeatedRows);
+
+	structureTimer_ = new QTimer(this);
+	connect(structureTimer_, &QTimer::timeout, this, &QHexView::scanStructure);
+
+	setSelectionModel(new QHexSelectionModel(this));
+
+	setHeatmapColors(heatmapLowColor_, heatmapHighColor_);
+
 	// default to a simple monospace font
 	setFont(QFont("Monospace", 8));
 	setShowAddressSeparator(true);
@@ -100,61 +562,263 @@ QHexView::QHexView(QWidget *parent)
  */
 void QHexView::setShowAddressSeparator(bool value) {
 	showAddressSeparator_ = value;
-	updateScrollbars();
+	updateLayout();
 }
 
 /**
- * @brief QHexView::formatAddress
- * @param address
- * @return
+ * formats addresses into caller provided storage. Consecutive rows are
+ * derived by adding the row size to the digits already computed, so that
+ * in the common case only the last digit or two of an address change
  */
-QString QHexView::formatAddress(address_t address) const {
+class QHexView::AddressFormatter {
+public:
+	static constexpr int MaxLength = 48;
 
-	static char buffer[32];
+public:
+	explicit AddressFormatter(const AddressFormat &format)
+		: format_(format) {
+	}
 
-	switch (addressSize_) {
-	case Address32: {
-		const uint16_t hi = (address >> 16) & 0xffff;
-		const uint16_t lo = (address & 0xffff);
+public:
+	/**
+	 * @brief length
+	 * @param format
+	 * @return the amount of characters an address takes up in this format
+	 */
+	static int length(const AddressFormat &format) {
+		const int separators = (format.group != 0) ? (format.digits - 1) / format.group : 0;
+		return format.digits + separators + (format.relative ? 1 : 0);
+	}
 
-		if (showAddressSeparator_) {
-			qsnprintf(buffer, sizeof(buffer), "%04x:%04x", hi, lo);
+	/**
+	 * starts formatting from |address|
+	 *
+	 * @brief reset
+	 * @param address
+	 */
+	void reset(address_t address) {
+		if (format_.relative) {
+			negative_ = address < format_.base;
+			value_    = negative_ ? format_.base - address : address - format_.base;
 		} else {
-			qsnprintf(buffer, sizeof(buffer), "%04x%04x", hi, lo);
+			negative_ = false;
+			value_    = address;
+		}
+
+		const uint64_t radix = format_.decimal ? 10 : 16;
+		uint64_t value       = value_;
+		for (int i = format_.digits - 1; i >= 0; --i) {
+			digits_[i] = static_cast<uint8_t>(value % radix);
+			value /= radix;
 		}
 	}
-		return QString::fromLocal8Bit(buffer);
-	case Address64: {
-		const uint32_t hi = (address >> 32) & 0xffffffff;
-		const uint32_t lo = (address & 0xffffffff);
 
-		if (hideLeadingAddressZeros_) {
-			if (showAddressSeparator_) {
-				qsnprintf(buffer, sizeof(buffer), "%04x:%08x", (hi & 0xffff), lo);
+	/**
+	 * moves on to the address |step| bytes after the current one
+	 *
+	 * @brief advance
+	 * @param step
+	 */
+	void advance(uint64_t step) {
+		if (negative_) {
+			// counting towards the base, the magnitude shrinks, which isn't
+			// worth doing incrementally
+			if (step < value_) {
+				reset(format_.base - (value_ - step));
 			} else {
-				qsnprintf(buffer, sizeof(buffer), "%04x%08x", (hi & 0xffff), lo);
+				reset(format_.base + (step - value_));
 			}
-		} else {
-			if (showAddressSeparator_) {
-				qsnprintf(buffer, sizeof(buffer), "%08x:%08x", hi, lo);
-			} else {
-				qsnprintf(buffer, sizeof(buffer), "%08x%08x", hi, lo);
+			return;
+		}
+
+		value_ += step;
+
+		// add |step| to the digits, stopping as soon as the carry runs out.
+		// Digits which don't fit in the address are dropped
+		const uint64_t radix = format_.decimal ? 10 : 16;
+		uint64_t carry       = step;
+		for (int i = format_.digits - 1; i >= 0 && carry != 0; --i) {
+			carry += digits_[i];
+			digits_[i] = static_cast<uint8_t>(carry % radix);
+			carry /= radix;
+		}
+	}
+
+	/**
+	 * @brief write
+	 * @param out must have room for at least MaxLength characters
+	 * @return the amount of characters written
+	 */
+	int write(char *out) const {
+		static constexpr char digit_chars[] = "0123456789abcdef";
+
+		char *p = out;
+		if (format_.relative) {
+			*p++ = negative_ ? '-' : '+';
+		}
+
+		for (int i = 0; i < format_.digits; ++i) {
+			if (format_.group != 0 && i != 0 && (format_.digits - i) % format_.group == 0) {
+				*p++ = format_.separator;
 			}
+			*p++ = digit_chars[digits_[i]];
 		}
+
+		return static_cast<int>(p - out);
+	}
+
+private:
+	AddressFormat format_;
+	uint8_t digits_[MaxLength] = {};
+	uint64_t value_            = 0; // magnitude of the displayed value
+	bool negative_             = false;
+};
+
+/**
+ * @brief QHexView::formatAddress
+ * @param address
+ * @return
+ */
+QString QHexView::formatAddress(address_t address) const {
+
+	char buffer[AddressFormatter::MaxLength];
+
+	AddressFormatter formatter(layout_.address);
+	formatter.reset(address);
+	return QString::fromLatin1(buffer, formatter.write(buffer));
+}
+
+/**
+ * works out how addresses are displayed from the current settings
+ *
+ * @brief QHexView::updateAddressFormat
+ */
+void QHexView::updateAddressFormat() {
+
+	AddressFormat &format = layout_.address;
+
+	const bool wide = (addressSize_ == Address64);
+
+	format.decimal  = decimalAddresses_;
+	format.relative = relativeAddresses_;
+	format.base     = relativeAddressBase_;
+
+	// when hiding the leading zeros of a 64-bit address, we show the low 48-bits
+	if (decimalAddresses_) {
+		format.digits    = wide ? (hideLeadingAddressZeros_ ? 15 : 20) : 10;
+		format.separator = ',';
+		format.group     = 3;
+	} else {
+		format.digits    = wide ? (hideLeadingAddressZeros_ ? 12 : 16) : 8;
+		format.separator = ':';
+		format.group     = wide ? 8 : 4;
 	}
-		return QString::fromLocal8Bit(buffer);
+
+	if (addressGroupSize_ != 0) {
+		format.group = addressGroupSize_;
 	}
 
-	return QString();
+	if (!showAddressSeparator_) {
+		format.group = 0;
+	}
 }
 
 /**
+ * reads the data again and redraws it, for when the data behind the device
+ * has changed. Other updates draw from the page cache
+ *
  * @brief QHexView::repaint
  */
 void QHexView::repaint() {
+	if (pageCache_) {
+		pageCache_->invalidate();
+	}
+
 	viewport()->repaint();
 }
 
+/**
+ * sets if addresses are shown in decimal rather than hex
+ *
+ * @brief QHexView::setShowDecimalAddresses
+ * @param value
+ */
+void QHexView::setShowDecimalAddresses(bool value) {
+	decimalAddresses_ = value;
+	updateLayout();
+	viewport()->update();
+}
+
+/**
+ * @brief QHexView::showDecimalAddresses
+ * @return
+ */
+bool QHexView::showDecimalAddresses() const {
+	return decimalAddresses_;
+}
+
+/**
+ * sets if addresses are shown as a signed offset from the relative address
+ * base rather than as absolute addresses
+ *
+ * @brief QHexView::setShowRelativeAddresses
+ * @param value
+ */
+void QHexView::setShowRelativeAddresses(bool value) {
+	relativeAddresses_ = value;
+	updateLayout();
+	viewport()->update();
+}
+
+/**
+ * @brief QHexView::showRelativeAddresses
+ * @return
+ */
+bool QHexView::showRelativeAddresses() const {
+	return relativeAddresses_;
+}
+
+/**
+ * @brief QHexView::setRelativeAddressBase
+ * @param base the address which relative addresses are shown from
+ */
+void QHexView::setRelativeAddressBase(address_t base) {
+	relativeAddressBase_ = base;
+	updateLayout();
+	viewport()->update();
+}
+
+/**
+ * @brief QHexView::relativeAddressBase
+ * @return
+ */
+auto QHexView::relativeAddressBase() const -> address_t {
+	return relativeAddressBase_;
+}
+
+/**
+ * sets how many digits of an address are grouped between separators, 0
+ * selects the default of splitting hex addresses in half and decimal ones
+ * into thousands
+ *
+ * @brief QHexView::setAddressGroupSize
+ * @param digits
+ */
+void QHexView::setAddressGroupSize(int digits) {
+	Q_ASSERT(digits >= 0);
+	addressGroupSize_ = digits;
+	updateLayout();
+	viewport()->update();
+}
+
+/**
+ * @brief QHexView::addressGroupSize
+ * @return
+ */
+int QHexView::addressGroupSize() const {
+	return addressGroupSize_;
+}
+
 /**
  * @brief QHexView::dataSize
  * @return how much data we are viewing
@@ -170,6 +834,8 @@ int64_t QHexView::dataSize() const {
  */
 void QHexView::setHideLeadingAddressZeros(bool value) {
 	hideLeadingAddressZeros_ = value;
+	updateLayout();
+	viewport()->update();
 }
 
 /**
@@ -202,7 +868,7 @@ void QHexView::setFont(const QFont &f) {
 
 	fontHeight_ = fm.height();
 
-	updateScrollbars();
+	updateLayout();
 
 	// TODO(eteran): assert that we are using a fixed font & find out if we care?
 	QAbstractScrollArea::setFont(font);
@@ -225,6 +891,14 @@ QMenu *QHexView::createStandardContextMenu() {
 		setShowAddress(value);
 	});
 
+	add_toggle_action_to_menu(menu, tr("D&ecimal Addresses"), decimalAddresses_, [this](bool value) {
+		setShowDecimalAddresses(value);
+	});
+
+	add_toggle_action_to_menu(menu, tr("&Relative Addresses"), relativeAddresses_, [this](bool value) {
+		setShowRelativeAddresses(value);
+	});
+
 	add_toggle_action_to_menu(menu, tr("Show &Hex"), showHex_, [this](bool value) {
 		setShowHexDump(value);
 	});
@@ -233,7 +907,56 @@ QMenu *QHexView::createStandardContextMenu() {
 		setShowAsciiDump(value);
 	});
 
-	if (commentServer_) {
+	add_toggle_action_to_menu(menu, tr("Color Byte C&lasses"), colorByteClasses_, [this](bool value) {
+		setColorByteClasses(value);
+	});
+
+	add_toggle_action_to_menu(menu, tr("C&ollapse Repeated Rows"), collapseRepeatedRows_, [this](bool value) {
+		setCollapseRepeatedRows(value);
+	});
+
+	struct {
+		const char *name;
+		TextEncoding encoding;
+	} static const encodings[] = {
+		{QT_TR_NOOP("Latin-1"), Latin1},
+		{QT_TR_NOOP("ISO-8859-2"), Iso8859_2},
+		{QT_TR_NOOP("ISO-8859-5"), Iso8859_5},
+		{QT_TR_NOOP("ISO-8859-15"), Iso8859_15},
+		{QT_TR_NOOP("Windows-1251"), Windows1251},
+		{QT_TR_NOOP("Windows-1252"), Windows1252},
+		{QT_TR_NOOP("EBCDIC (IBM037)"), Ebcdic037},
+		{QT_TR_NOOP("UTF-8"), Utf8},
+		{QT_TR_NOOP("UTF-16LE"), Utf16LE},
+		{QT_TR_NOOP("UTF-16BE"), Utf16BE},
+	};
+
+	auto encodingMenu = new QMenu(tr("Text &Encoding"), menu);
+	for (const auto &entry : encodings) {
+		const TextEncoding encoding = entry.encoding;
+		add_toggle_action_to_menu(encodingMenu, tr(entry.name), textEncoding_ == encoding, [this, encoding]() {
+			setTextEncoding(encoding);
+		});
+	}
+
+	menu->addMenu(encodingMenu);
+
+	auto heatmapMenu = new QMenu(tr("&Heatmap"), menu);
+	add_toggle_action_to_menu(heatmapMenu, tr("Off"), heatmapMode_ == NoHeatmap, [this]() {
+		setHeatmapMode(NoHeatmap);
+	});
+
+	add_toggle_action_to_menu(heatmapMenu, tr("Color Background"), heatmapMode_ == HeatmapBackground, [this]() {
+		setHeatmapMode(HeatmapBackground);
+	});
+
+	add_toggle_action_to_menu(heatmapMenu, tr("Color Text"), heatmapMode_ == HeatmapText, [this]() {
+		setHeatmapMode(HeatmapText);
+	});
+
+	menu->addMenu(heatmapMenu);
+
+	if (hasComments()) {
 		add_toggle_action_to_menu(menu, tr("Show &Comments"), showComments_, [this](bool value) {
 			setShowComments(value);
 		});
@@ -261,37 +984,149 @@ QMenu *QHexView::createStandardContextMenu() {
 			setWordWidth(8);
 		});
 
+		add_toggle_action_to_menu(wordMenu, tr("16 Bytes"), wordWidth_ == 16, [this]() {
+			setWordWidth(16);
+		});
+
 		menu->addMenu(wordMenu);
-	}
 
-	if (userCanSetRowWidth_) {
-		auto rowMenu = new QMenu(tr("Set Row Width"), menu);
-		add_toggle_action_to_menu(rowMenu, tr("1 Word"), rowWidth_ == 1, [this]() {
-			setRowWidth(1);
+		auto byteOrderMenu = new QMenu(tr("Set Byte Order"), menu);
+		add_toggle_action_to_menu(byteOrderMenu, tr("Little Endian"), byteOrder_ == LittleEndian, [this]() {
+			setByteOrder(LittleEndian);
 		});
 
-		add_toggle_action_to_menu(rowMenu, tr("2 Words"), rowWidth_ == 2, [this]() {
-			setRowWidth(2);
+		add_toggle_action_to_menu(byteOrderMenu, tr("Big Endian (As Stored)"), byteOrder_ == BigEndian, [this]() {
+			setByteOrder(BigEndian);
 		});
 
-		add_toggle_action_to_menu(rowMenu, tr("4 Words"), rowWidth_ == 4, [this]() {
-			setRowWidth(4);
+		menu->addMenu(byteOrderMenu);
+
+		auto formatMenu = new QMenu(tr("Set Data Format"), menu);
+		add_toggle_action_to_menu(formatMenu, tr("Hexadecimal"), dataFormat_ == Hexadecimal, [this]() {
+			setDataFormat(Hexadecimal);
 		});
 
-		add_toggle_action_to_menu(rowMenu, tr("8 Words"), rowWidth_ == 8, [this]() {
-			setRowWidth(8);
+		add_toggle_action_to_menu(formatMenu, tr("Binary"), dataFormat_ == Binary, [this]() {
+			setDataFormat(Binary);
 		});
 
-		add_toggle_action_to_menu(rowMenu, tr("16 Words"), rowWidth_ == 16, [this]() {
+		add_toggle_action_to_menu(formatMenu, tr("Octal"), dataFormat_ == Octal, [this]() {
+			setDataFormat(Octal);
+		});
+
+		add_toggle_action_to_menu(formatMenu, tr("Unsigned Decimal"), dataFormat_ == UnsignedDecimal, [this]() {
+			setDataFormat(UnsignedDecimal);
+		});
+
+		add_toggle_action_to_menu(formatMenu, tr("Signed Decimal"), dataFormat_ == SignedDecimal, [this]() {
+			setDataFormat(SignedDecimal);
+		});
+
+		add_toggle_action_to_menu(formatMenu, tr("Floating Point (4 and 8 Byte Words)"), dataFormat_ == FloatingPoint, [this]() {
+			setDataFormat(FloatingPoint);
+		});
+
+		menu->addMenu(formatMenu);
+	}
+
+	if (userCanSetRowWidth_) {
+		auto rowMenu = new QMenu(tr("Set Row Width"), menu);
+		const bool fixed = (rowWidthMode_ == FixedRowWidth);
+		add_toggle_action_to_menu(rowMenu, tr("1 Word"), fixed && rowWidth_ == 1, [this]() {
+			setRowWidth(1);
+		});
+
+		add_toggle_action_to_menu(rowMenu, tr("2 Words"), fixed && rowWidth_ == 2, [this]() {
+			setRowWidth(2);
+		});
+
+		add_toggle_action_to_menu(rowMenu, tr("4 Words"), fixed && rowWidth_ == 4, [this]() {
+			setRowWidth(4);
+		});
+
+		add_toggle_action_to_menu(rowMenu, tr("8 Words"), fixed && rowWidth_ == 8, [this]() {
+			setRowWidth(8);
+		});
+
+		add_toggle_action_to_menu(rowMenu, tr("16 Words"), fixed && rowWidth_ == 16, [this]() {
 			setRowWidth(16);
 		});
 
+		add_toggle_action_to_menu(rowMenu, tr("32 Words"), fixed && rowWidth_ == 32, [this]() {
+			setRowWidth(32);
+		});
+
+		rowMenu->addSeparator();
+
+		add_toggle_action_to_menu(rowMenu, tr("Fit To Window"), rowWidthMode_ == FitRowWidth, [this]() {
+			setRowWidthMode(FitRowWidth);
+		});
+
+		add_toggle_action_to_menu(rowMenu, tr("Fit To Window (Power Of Two)"), rowWidthMode_ == FitRowWidthPowerOfTwo, [this]() {
+			setRowWidthMode(FitRowWidthPowerOfTwo);
+		});
+
 		menu->addMenu(rowMenu);
 	}
 
 	menu->addSeparator();
 	menu->addAction(tr("&Copy Selection To Clipboard"), this, SLOT(mnuCopy()));
 	menu->addAction(tr("&Copy Address To Clipboard"), this, SLOT(mnuAddrCopy()));
+
+	if (hasSelectedText() && isEditable()) {
+		menu->addAction(tr("&Paste Hex (Overwrite)"), this, SLOT(mnuPasteOverwrite()));
+		menu->addAction(tr("Paste Hex (&Insert)"), this, SLOT(mnuPasteInsert()));
+	}
+
+	if (hasSelectedText()) {
+		menu->addAction(tr("Save Selection &As..."), this, SLOT(mnuSaveSelection()));
+
+		const std::pair<QHexCodec::ExportFormat, QString> formats[] = {
+			{QHexCodec::RawHex, tr("Hex")},
+			{QHexCodec::CArray, tr("C Array")},
+			{QHexCodec::RustArray, tr("Rust Array")},
+			{QHexCodec::PythonBytes, tr("Python Bytes")},
+			{QHexCodec::Base64, tr("Base64")},
+			{QHexCodec::IntelHex, tr("Intel HEX")},
+		};
+
+		auto copyMenu   = new QMenu(tr("Copy Selection As"), menu);
+		auto exportMenu = new QMenu(tr("Export Selection As"), menu);
+
+		for (const auto &format : formats) {
+			copyMenu->addAction(format.second, this, [this, format]() {
+				copySelectionAs(format.first);
+			});
+
+			exportMenu->addAction(format.second + QLatin1String("..."), this, [this, format]() {
+				const QString filename = QFileDialog::getSaveFileName(this, tr("Export Selection As %1").arg(format.second));
+				if (filename.isEmpty()) {
+					return;
+				}
+
+				QFile file(filename);
+				QString error;
+				if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+					error = file.errorString();
+				} else if (exportSelection(format.first, &file, &error)) {
+					return;
+				}
+
+				QMessageBox::warning(this, tr("Export Selection As"), tr("Could not export the selection: %1").arg(error));
+			});
+		}
+
+		menu->addMenu(copyMenu);
+		menu->addMenu(exportMenu);
+	}
+
+	if (hasSelectedText()) {
+		menu->addAction(tr("Make Addresses Relative To &Selection"), this, [this]() {
+			setRelativeAddressBase(selectedBytesAddress());
+			setShowRelativeAddresses(true);
+		});
+	}
+
 	return menu;
 }
 
@@ -313,6 +1148,10 @@ void QHexView::contextMenuEvent(QContextMenuEvent *event) {
  */
 int64_t QHexView::normalizedOffset() const {
 
+	if (collapseRepeatedRows_) {
+		return repeatIndex_.line(verticalScrollBar()->value()).row * bytesPerRow();
+	}
+
 	int64_t offset = static_cast<int64_t>(verticalScrollBar()->value()) * bytesPerRow();
 
 	if (origin_ != 0) {
@@ -338,23 +1177,43 @@ void QHexView::mnuCopy() {
 		const int chars_per_row = bytesPerRow();
 		int64_t offset          = normalizedOffset();
 
-		const int64_t end       = std::max(selectionStart_, selectionEnd_);
-		const int64_t start     = std::min(selectionStart_, selectionEnd_);
+		const int64_t end       = selection().end();
+		const int64_t start     = selection().start();
 		const int64_t data_size = dataSize();
 
+		char address_buffer[AddressFormatter::MaxLength];
+		AddressFormatter address_formatter(layout_.address);
+		address_formatter.reset(addressOffset_ + offset);
+
 		// offset now refers to the first visible byte
 		while (offset < end) {
 
+			// collapsed rows are copied the way they are shown, but only when
+			// there are addresses to tell how many rows a "*" stands for,
+			// otherwise they are copied in full so the text pastes back as
+			// the same bytes
+			if (collapseRepeatedRows_ && showAddress_) {
+				const QHexRepeatIndex::Line current = repeatIndex_.line(repeatIndex_.lineForRow(offset / chars_per_row));
+				if (current.repeats != 0) {
+					const int64_t next = (current.row + current.repeats) * chars_per_row;
+					if (next > start) {
+						ss << "*\n";
+					}
+
+					offset = next;
+					address_formatter.reset(addressOffset_ + offset);
+					continue;
+				}
+			}
+
 			if ((offset + chars_per_row) > start) {
 
-				data_->seek(offset);
-				const QByteArray row_data = data_->read(chars_per_row);
+				const QByteArray &row_data = readRow(offset, chars_per_row);
 
 				if (!row_data.isEmpty()) {
 					if (showAddress_) {
-						const address_t address_rva = addressOffset_ + offset;
-						const QString addressBuffer = formatAddress(address_rva);
-						ss << addressBuffer << '|';
+						const int address_length = address_formatter.write(address_buffer);
+						ss << QLatin1String(address_buffer, address_length) << '|';
 					}
 
 					if (showHex_) {
@@ -367,7 +1226,7 @@ void QHexView::mnuCopy() {
 						ss << "|";
 					}
 
-					if (showComments_ && commentServer_) {
+					if (showComments_ && hasComments()) {
 						drawCommentsToBuffer(ss, offset, data_size);
 					}
 				}
@@ -375,6 +1234,7 @@ void QHexView::mnuCopy() {
 				ss << "\n";
 			}
 			offset += chars_per_row;
+			address_formatter.advance(chars_per_row);
 		}
 
 		QApplication::clipboard()->setText(s);
@@ -400,6 +1260,47 @@ void QHexView::mnuAddrCopy() {
 	}
 }
 
+/**
+ * slot used to paste the hex text on the clipboard over the selection
+ *
+ * @brief QHexView::mnuPasteOverwrite
+ */
+void QHexView::mnuPasteOverwrite() {
+	QString error;
+	if (!pasteHex(QApplication::clipboard()->text(), PasteOverwrite, &error)) {
+		QMessageBox::warning(this, tr("Paste Hex"), tr("Could not paste: %1").arg(error));
+	}
+}
+
+/**
+ * slot used to insert the hex text on the clipboard before the selection
+ *
+ * @brief QHexView::mnuPasteInsert
+ */
+void QHexView::mnuPasteInsert() {
+	QString error;
+	if (!pasteHex(QApplication::clipboard()->text(), PasteInsert, &error)) {
+		QMessageBox::warning(this, tr("Paste Hex"), tr("Could not paste: %1").arg(error));
+	}
+}
+
+/**
+ * slot used to save the selection to a file chosen by the user
+ *
+ * @brief QHexView::mnuSaveSelection
+ */
+void QHexView::mnuSaveSelection() {
+	const QString filename = QFileDialog::getSaveFileName(this, tr("Save Selection As"));
+	if (filename.isEmpty()) {
+		return;
+	}
+
+	QString error;
+	if (!saveSelection(filename, &error)) {
+		QMessageBox::warning(this, tr("Save Selection As"), tr("Could not save the selection: %1").arg(error));
+	}
+}
+
 /**
  * slot used to set the font of the widget based on dialog selector
  *
@@ -415,7 +1316,19 @@ void QHexView::mnuSetFont() {
  * @brief QHexView::clear
  */
 void QHexView::clear() {
-	data_ = nullptr;
+	data_       = nullptr;
+	regionData_ = nullptr;
+	knownSize_  = 0;
+	pageCache_.reset();
+
+	if (wrappedData_) {
+		disconnect(wrappedData_.get(), nullptr, this, nullptr);
+		wrappedData_.reset();
+	}
+
+	// a selection model shared with other views would keep pointing into the
+	// data which is gone
+	deselect();
 	viewport()->update();
 }
 
@@ -424,7 +1337,7 @@ void QHexView::clear() {
  * @return true if any text is selected
  */
 bool QHexView::hasSelectedText() const {
-	return !(selectionStart_ == -1 || selectionEnd_ == -1);
+	return !selection().isEmpty();
 }
 
 /**
@@ -451,10 +1364,19 @@ void QHexView::keyPressEvent(QKeyEvent *event) {
 	if (event == QKeySequence::SelectAll) {
 		selectAll();
 		viewport()->update();
+	} else if (event == QKeySequence::Paste && hasSelectedText() && isEditable()) {
+		mnuPasteOverwrite();
+	} else if (event->modifiers() == (Qt::ControlModifier | Qt::ShiftModifier) && event->key() == Qt::Key_V && hasSelectedText() && isEditable()) {
+		mnuPasteInsert();
 	} else if (event == QKeySequence::MoveToStartOfDocument) {
 		scrollTo(0);
 	} else if (event == QKeySequence::MoveToEndOfDocument) {
 		scrollTo(dataSize() - bytesPerRow());
+	} else if (collapseRepeatedRows_ && event->modifiers() & Qt::ControlModifier && event->key() == Qt::Key_Down) {
+		// the view can't start mid row, so scroll by lines instead of bytes
+		verticalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+	} else if (collapseRepeatedRows_ && event->modifiers() & Qt::ControlModifier && event->key() == Qt::Key_Up) {
+		verticalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepSub);
 	} else if (event->modifiers() & Qt::ControlModifier && event->key() == Qt::Key_Down) {
 		int64_t offset = normalizedOffset();
 		if (offset + 1 < dataSize()) {
@@ -465,7 +1387,7 @@ void QHexView::keyPressEvent(QKeyEvent *event) {
 		if (offset > 0) {
 			scrollTo(offset - 1);
 		}
-	} else if (event->modifiers() & Qt::ShiftModifier && hasSelectedText()) {
+	} else if (event->modifiers() & Qt::ShiftModifier && selectionStart_ != -1 && selectionEnd_ != -1) {
 		// Attempting to match the highlighting behavior of common text
 		// editors where highlighting to the left or up will keep the
 		// first character (byte in our case) highlighted while also
@@ -505,6 +1427,7 @@ void QHexView::keyPressEvent(QKeyEvent *event) {
 		default:
 			break;
 		}
+		updateSelection();
 		viewport()->update();
 	} else {
 		QAbstractScrollArea::keyPressEvent(event);
@@ -512,16 +1435,57 @@ void QHexView::keyPressEvent(QKeyEvent *event) {
 }
 
 /**
- * @brief QHexView::line3
- * @return the x coordinate of the 3rd line
+ * recalculates the cached column geometry, this needs to happen whenever
+ * anything which affects the width of a column changes. Painting and hit
+ * testing then only read the cached values
+ *
+ * @brief QHexView::updateLayout
  */
-int QHexView::line3() const {
+void QHexView::updateLayout() {
+
+	updateRowFormatter();
+	updateAddressFormat();
+
+	if (rowWidthMode_ != FixedRowWidth) {
+		const int row_width = fittedRowWidth();
+		if (row_width != rowWidth_) {
+			// reflow, keeping the first visible byte at the top of the view
+			const int64_t first_visible = normalizedOffset();
+			rowWidth_                   = row_width;
+			updateRepeatIndex();
+			scrollTo(first_visible);
+		}
+	}
+
+	updateRepeatIndex();
+
+	layout_.line1 = 0;
+	if (showAddress_) {
+		const int elements = addressLength();
+		layout_.line1      = (elements * fontWidth_) + (fontWidth_ / 2);
+	}
+
+	layout_.line2 = layout_.line1;
+	if (showHex_) {
+		const int elements = rowWidth_ * (layout_.charsPerWord + 1) - 1;
+		layout_.line2      = hexDumpLeft() + (elements * fontWidth_) + (fontWidth_ / 2);
+	}
+
+	layout_.line3 = layout_.line2;
 	if (showAscii_) {
 		const int elements = bytesPerRow();
-		return asciiDumpLeft() + (elements * fontWidth_) + (fontWidth_ / 2);
+		layout_.line3      = asciiDumpLeft() + (elements * fontWidth_) + (fontWidth_ / 2);
 	}
 
-	return line2();
+	updateScrollbars();
+}
+
+/**
+ * @brief QHexView::line3
+ * @return the x coordinate of the 3rd line
+ */
+int QHexView::line3() const {
+	return layout_.line3;
 }
 
 /**
@@ -529,12 +1493,7 @@ int QHexView::line3() const {
  * @return the x coordinate of the 2nd line
  */
 int QHexView::line2() const {
-	if (showHex_) {
-		const int elements = rowWidth_ * (charsPerWord() + 1) - 1;
-		return hexDumpLeft() + (elements * fontWidth_) + (fontWidth_ / 2);
-	}
-
-	return line1();
+	return layout_.line2;
 }
 
 /**
@@ -542,12 +1501,7 @@ int QHexView::line2() const {
  * @return the x coordinate of the 1st line
  */
 int QHexView::line1() const {
-	if (showAddress_) {
-		const int elements = addressLength();
-		return (elements * fontWidth_) + (fontWidth_ / 2);
-	}
-
-	return 0;
+	return layout_.line1;
 }
 
 /**
@@ -579,7 +1533,7 @@ int QHexView::commentLeft() const {
  * @return how many characters each word takes up
  */
 int QHexView::charsPerWord() const {
-	return wordWidth_ * 2;
+	return layout_.charsPerWord;
 }
 
 /**
@@ -587,13 +1541,7 @@ int QHexView::charsPerWord() const {
  * @return the length in characters the address will take up
  */
 int QHexView::addressLength() const {
-	if (hideLeadingAddressZeros_ && addressSize_ == Address64) {
-		const int addressLength = ((addressSize_ * CHAR_BIT) / 4) - 4;
-		return addressLength + (showAddressSeparator_ ? 1 : 0);
-	}
-
-	const int addressLength = (addressSize_ * CHAR_BIT) / 4;
-	return addressLength + (showAddressSeparator_ ? 1 : 0);
+	return AddressFormatter::length(layout_.address);
 }
 
 /**
@@ -605,7 +1553,8 @@ void QHexView::updateScrollbars() {
 	const int64_t sz = dataSize();
 	const int bpr    = bytesPerRow();
 
-	const int maxval = sz / bpr + ((sz % bpr) ? 1 : 0) - viewport()->height() / fontHeight_;
+	const int64_t rows = collapseRepeatedRows_ ? repeatIndex_.lineCount() : sz / bpr + ((sz % bpr) ? 1 : 0);
+	const int maxval   = rows - viewport()->height() / fontHeight_;
 
 	verticalScrollBar()->setMaximum(std::max(0, maxval));
 	horizontalScrollBar()->setMaximum(std::max(0, ((line3() - viewport()->width()) / fontWidth_)));
@@ -619,7 +1568,17 @@ void QHexView::updateScrollbars() {
  */
 void QHexView::scrollTo(address_t offset) {
 
-	const int bpr     = bytesPerRow();
+	const int bpr = bytesPerRow();
+
+	// collapsed rows don't allow for a view which starts mid row
+	if (collapseRepeatedRows_) {
+		origin_ = 0;
+		updateScrollbars();
+		verticalScrollBar()->setValue(repeatIndex_.lineForRow(offset / bpr));
+		viewport()->update();
+		return;
+	}
+
 	origin_           = offset % bpr;
 	address_t address = offset / bpr;
 
@@ -641,7 +1600,7 @@ void QHexView::scrollTo(address_t offset) {
  */
 void QHexView::setShowAddress(bool show) {
 	showAddress_ = show;
-	updateScrollbars();
+	updateLayout();
 	viewport()->update();
 }
 
@@ -653,7 +1612,7 @@ void QHexView::setShowAddress(bool show) {
  */
 void QHexView::setShowHexDump(bool show) {
 	showHex_ = show;
-	updateScrollbars();
+	updateLayout();
 	viewport()->update();
 }
 
@@ -665,7 +1624,7 @@ void QHexView::setShowHexDump(bool show) {
  */
 void QHexView::setShowComments(bool show) {
 	showComments_ = show;
-	updateScrollbars();
+	updateLayout();
 	viewport()->update();
 }
 
@@ -677,7 +1636,7 @@ void QHexView::setShowComments(bool show) {
  */
 void QHexView::setShowAsciiDump(bool show) {
 	showAscii_ = show;
-	updateScrollbars();
+	updateLayout();
 	viewport()->update();
 }
 
@@ -688,12 +1647,75 @@ void QHexView::setShowAsciiDump(bool show) {
  * @param rowWidth
  */
 void QHexView::setRowWidth(int rowWidth) {
-	Q_ASSERT(rowWidth >= 0);
-	rowWidth_ = rowWidth;
-	updateScrollbars();
+	Q_ASSERT(rowWidth > 0 && rowWidth * wordWidth_ <= MaxBytesPerRow);
+
+	// rows are drawn through buffers of MaxBytesPerRow
+	rowWidthMode_ = FixedRowWidth;
+	rowWidth_     = std::clamp(rowWidth, 1, MaxBytesPerRow / wordWidth_);
+	updateLayout();
+	viewport()->update();
+}
+
+/**
+ * sets how the row width is chosen. When fitting to the window, the row width
+ * is recalculated whenever the viewport is resized or the columns change
+ *
+ * @brief QHexView::setRowWidthMode
+ * @param mode
+ */
+void QHexView::setRowWidthMode(RowWidthMode mode) {
+	rowWidthMode_ = mode;
+	updateLayout();
 	viewport()->update();
 }
 
+/**
+ * @brief QHexView::rowWidthMode
+ * @return
+ */
+QHexView::RowWidthMode QHexView::rowWidthMode() const {
+	return rowWidthMode_;
+}
+
+/**
+ * @brief QHexView::fittedRowWidth
+ * @return the widest row, in words, whose columns fit in the viewport
+ */
+int QHexView::fittedRowWidth() const {
+
+	// every column is a fixed part plus a part which grows linearly with the
+	// amount of words in the row, see updateLayout
+	int fixed_width = showAddress_ ? (addressLength() * fontWidth_) + (fontWidth_ / 2) : 0;
+	int word_width  = 0;
+
+	if (showHex_) {
+		fixed_width += (fontWidth_ / 2) - fontWidth_ + (fontWidth_ / 2);
+		word_width += (layout_.charsPerWord + 1) * fontWidth_;
+	}
+
+	if (showAscii_) {
+		fixed_width += (fontWidth_ / 2) + (fontWidth_ / 2);
+		word_width += wordWidth_ * fontWidth_;
+	}
+
+	const int max_words = MaxBytesPerRow / wordWidth_;
+
+	if (word_width == 0) {
+		return std::min(rowWidth_, max_words);
+	}
+	int words           = std::clamp((viewport()->width() - fixed_width) / word_width, 1, max_words);
+
+	if (rowWidthMode_ == FitRowWidthPowerOfTwo) {
+		int power = 1;
+		while (power * 2 <= words) {
+			power *= 2;
+		}
+		words = power;
+	}
+
+	return words;
+}
+
 /**
  * sets how many bytes represent a word
  *
@@ -701,12 +1723,76 @@ void QHexView::setRowWidth(int rowWidth) {
  * @param wordWidth
  */
 void QHexView::setWordWidth(int wordWidth) {
-	Q_ASSERT(wordWidth >= 0);
+	Q_ASSERT(wordWidth == 1 || wordWidth == 2 || wordWidth == 4 || wordWidth == 8 || wordWidth == 16);
 	wordWidth_ = wordWidth;
-	updateScrollbars();
+	rowWidth_  = std::min(rowWidth_, MaxBytesPerRow / wordWidth_);
+	updateLayout();
+	viewport()->update();
+}
+
+/**
+ * sets the encoding used to decode the text column
+ *
+ * @brief QHexView::setTextEncoding
+ * @param encoding
+ */
+void QHexView::setTextEncoding(TextEncoding encoding) {
+	textEncoding_ = encoding;
 	viewport()->update();
 }
 
+/**
+ * @brief QHexView::textEncoding
+ * @return
+ */
+QHexView::TextEncoding QHexView::textEncoding() const {
+	return textEncoding_;
+}
+
+/**
+ * sets how words are rendered in the data column
+ *
+ * @brief QHexView::setDataFormat
+ * @param dataFormat
+ */
+void QHexView::setDataFormat(DataFormat dataFormat) {
+	dataFormat_ = dataFormat;
+	updateLayout();
+	viewport()->update();
+}
+
+/**
+ * @brief QHexView::dataFormat
+ * @return
+ */
+QHexView::DataFormat QHexView::dataFormat() const {
+	return dataFormat_;
+}
+
+/**
+ * sets the order in which the bytes of multi-byte words are displayed
+ *
+ * @brief QHexView::setByteOrder
+ * @param byteOrder
+ */
+void QHexView::setByteOrder(ByteOrder byteOrder) {
+	byteOrder_ = byteOrder;
+
+	resetStructure();
+
+	updateRowFormatter();
+	updateToolTip();
+	viewport()->update();
+}
+
+/**
+ * @brief QHexView::byteOrder
+ * @return
+ */
+QHexView::ByteOrder QHexView::byteOrder() const {
+	return byteOrder_;
+}
+
 /**
  * @brief QHexView::bytesPerRow
  * @return
@@ -762,6 +1848,12 @@ int64_t QHexView::pixelToWord(int x, int y) const {
 		break;
 	}
 
+	// when collapsing, rows no longer follow each other, a marker maps to the
+	// first of the rows it stands in for
+	if (collapseRepeatedRows_) {
+		return repeatIndex_.line(verticalScrollBar()->value() + y).row * rowWidth_ + x;
+	}
+
 	// starting offset in bytes
 	int64_t start_offset = normalizedOffset();
 
@@ -781,26 +1873,51 @@ int64_t QHexView::pixelToWord(int x, int y) const {
  * @brief QHexView::updateToolTip
  */
 void QHexView::updateToolTip() {
-	if (selectedBytesSize() <= 0) {
+	if (!pageCache_ || selectedBytesSize() <= 0) {
 		return;
 	}
 
-	auto sb               = selectedBytes();
 	const address_t start = selectedBytesAddress();
-	const address_t end   = selectedBytesAddress() + sb.size();
+	const address_t end   = selection().end() + addressOffset_;
+	const size_t ranges   = selection().ranges().size();
 
-	auto data       = reinterpret_cast<uchar *>(sb.data());
 	QString tooltip = QString("<p style='white-space:pre'>") // prevent word wrap
 					  % QString("<b>Range: </b>") % formatAddress(start) % " - " % formatAddress(end);
 
-	switch (sb.size()) {
-	case sizeof(quint32):
-		tooltip += QString("<br><b>UInt32:</b> ") % QString::number(qFromLittleEndian<quint32>(data)) % QString("<br><b>Int32:</b> ") % QString::number(qFromLittleEndian<qint32>(data));
+	highlights_.query(start, start + 1, [&tooltip](const QHexHighlights::Highlight &highlight) {
+		if (!highlight.label.isEmpty()) {
+			tooltip += QString("<br><b>Label:</b> ") % highlight.label.toHtmlEscaped();
+		}
+	});
+
+	if (ranges != 1) {
+		tooltip += QString("<br><b>Ranges:</b> ") % QString::number(ranges) % QString("<br><b>Bytes:</b> ") % QString::number(selectedBytesSize());
+	}
+
+	// values are only shown for a single range, and only the bytes they need
+	// are read
+	uchar data[sizeof(quint64)];
+	qint64 size = 0;
+	if (ranges == 1 && (selectedBytesSize() == sizeof(quint32) || selectedBytesSize() == sizeof(quint64))) {
+		size = pageCache_->read(selection().start(), reinterpret_cast<char *>(data), selectedBytesSize());
+	}
+
+	switch (size) {
+	case sizeof(quint32): {
+		const quint32 value = (byteOrder_ == BigEndian) ? qFromBigEndian<quint32>(data) : qFromLittleEndian<quint32>(data);
+		float f;
+		memcpy(&f, &value, sizeof(f));
+		tooltip += QString("<br><b>UInt32:</b> ") % QString::number(value) % QString("<br><b>Int32:</b> ") % QString::number(static_cast<qint32>(value)) % QString("<br><b>Float:</b> ") % QString::number(f, 'g', 9);
 		break;
-	case sizeof(quint64):
-		tooltip += QString("<br><b>UInt64:</b> ") % QString::number(qFromLittleEndian<quint64>(data)) % QString("<br><b>Int64</b> ") % QString::number(qFromLittleEndian<qint64>(data));
+	}
+	case sizeof(quint64): {
+		const quint64 value = (byteOrder_ == BigEndian) ? qFromBigEndian<quint64>(data) : qFromLittleEndian<quint64>(data);
+		double d;
+		memcpy(&d, &value, sizeof(d));
+		tooltip += QString("<br><b>UInt64:</b> ") % QString::number(value) % QString("<br><b>Int64</b> ") % QString::number(static_cast<qint64>(value)) % QString("<br><b>Double:</b> ") % QString::number(d, 'g', 17);
 		break;
 	}
+	}
 
 	tooltip += "</p>";
 
@@ -829,6 +1946,7 @@ void QHexView::mouseDoubleClickEvent(QMouseEvent *event) {
 
 			selectionStart_ = byte_offset;
 			selectionEnd_   = selectionStart_ + wordWidth_;
+			updateSelection();
 			viewport()->update();
 		} else if (x < line1()) {
 			highlighting_ = Highlighting::Data;
@@ -845,6 +1963,7 @@ void QHexView::mouseDoubleClickEvent(QMouseEvent *event) {
 
 			selectionStart_ = byte_offset;
 			selectionEnd_   = byte_offset + chars_per_row;
+			updateSelection();
 			viewport()->update();
 		}
 	}
@@ -876,8 +1995,22 @@ void QHexView::mousePressEvent(QMouseEvent *event) {
 			}
 		}
 
+		const bool extend = selectionStart_ != -1 && (event->modifiers() & Qt::ShiftModifier);
+
+		// Ctrl adds a new range to the ones already selected, Alt selects a
+		// block of columns rather than a range of bytes
+		if (!extend) {
+			if (event->modifiers() & Qt::ControlModifier) {
+				previousSelection_ = selection();
+			} else {
+				previousSelection_.clear();
+			}
+
+			columnSelection_ = (event->modifiers() & Qt::AltModifier);
+		}
+
 		if (offset < dataSize()) {
-			if (hasSelectedText() && (event->modifiers() & Qt::ShiftModifier)) {
+			if (extend) {
 				selectionEnd_ = byte_offset;
 			} else {
 				selectionStart_ = byte_offset;
@@ -886,6 +2019,7 @@ void QHexView::mousePressEvent(QMouseEvent *event) {
 		} else {
 			selectionStart_ = selectionEnd_ = -1;
 		}
+		updateSelection();
 		viewport()->update();
 	}
 	if (event->button() == Qt::RightButton) {
@@ -930,6 +2064,8 @@ void QHexView::mouseMoveEvent(QMouseEvent *event) {
 			if (!isInViewableArea(selectionEnd_)) {
 				ensureVisible(selectionEnd_);
 			}
+
+			updateSelection();
 		}
 		viewport()->update();
 		updateToolTip();
@@ -955,10 +2091,41 @@ void QHexView::ensureVisible(int64_t index) {
 }
 
 /**
+ * when decompressGzip() is set and the library was built with zlib, gzip
+ * compressed data is shown decompressed through a QHexGzipDevice, which
+ * grows as it gets through the file, see dataSizeChanged. A file with holes
+ * is read through a QHexSparseFileDevice, so that the holes aren't read
+ *
  * @brief QHexView::setData
  * @param d
  */
 void QHexView::setData(QIODevice *d) {
+
+	// the view reads the old data until it has moved on to the new, which
+	// other views may still be showing
+	const std::shared_ptr<QIODevice> previous_wrapped = std::move(wrappedData_);
+	if (previous_wrapped) {
+		disconnect(previous_wrapped.get(), nullptr, this, nullptr);
+	}
+
+#ifdef QHEXVIEW_HAVE_ZLIB
+	if (decompressGzip_ && !d->isSequential() && QHexGzipDevice::isGzip(d)) {
+		if (std::shared_ptr<QHexGzipDevice> gzip = QHexGzipDevice::forDevice(d)) {
+			connect(gzip.get(), &QHexGzipDevice::sizeChanged, this, &QHexView::dataSizeChanged);
+			wrappedData_ = std::move(gzip);
+			d            = wrappedData_.get();
+		}
+	}
+#endif
+
+	auto file = qobject_cast<QFileDevice *>(d);
+	if (file && QHexSparseFileDevice::hasHoles(file)) {
+		if (std::shared_ptr<QHexSparseFileDevice> sparse = QHexSparseFileDevice::forFile(file)) {
+			wrappedData_ = std::move(sparse);
+			d            = wrappedData_.get();
+		}
+	}
+
 	if (d->isSequential() || !d->size()) {
 		internalBuffer_ = std::make_unique<QBuffer>();
 		internalBuffer_->setData(d->readAll());
@@ -972,16 +2139,44 @@ void QHexView::setData(QIODevice *d) {
 		addressSize_ = Address64;
 	}
 
+	// data with holes, such as a firmware image, is shown at its real addresses
+	auto region = qobject_cast<QHexRegionDevice *>(data_);
+	regionData_ = (region && !region->holesAreData()) ? region : nullptr;
+	if (regionData_) {
+		setAddressOffset(regionData_->baseAddress());
+		if (addressOffset_ + static_cast<address_t>(data_->size()) > Q_UINT64_C(0xffffffff)) {
+			addressSize_ = Address64;
+		}
+	}
+
+	pageCache_ = QHexPageCache::forDevice(data_);
+	knownSize_ = data_->size();
+
 	deselect();
-	updateScrollbars();
+	repeatIndex_.clear();
+
+	resetStructure();
+
+	updateLayout();
 	viewport()->update();
 }
 
+/**
+ * the cache the view reads the data through. Every view of a device shares
+ * the same one, and so can other users of the data such as a QHexRecordModel
+ *
+ * @brief QHexView::pageCache
+ * @return
+ */
+std::shared_ptr<QHexPageCache> QHexView::pageCache() const {
+	return pageCache_;
+}
+
 /**
  * @brief QHexView::resizeEvent
  */
 void QHexView::resizeEvent(QResizeEvent *) {
-	updateScrollbars();
+	updateLayout();
 }
 
 /**
@@ -992,26 +2187,6 @@ void QHexView::setAddressOffset(address_t offset) {
 	addressOffset_ = offset;
 }
 
-/**
- * @brief QHexView::isSelected
- * @param index
- * @return
- */
-bool QHexView::isSelected(int64_t index) const {
-
-	bool ret = false;
-	if (index < dataSize()) {
-		if (selectionStart_ != selectionEnd_) {
-			if (selectionStart_ < selectionEnd_) {
-				ret = (index >= selectionStart_ && index < selectionEnd_);
-			} else {
-				ret = (index >= selectionEnd_ && index < selectionStart_);
-			}
-		}
-	}
-	return ret;
-}
-
 /**
  * @brief QHexView::drawComments
  * @param painter
@@ -1023,10 +2198,9 @@ void QHexView::drawComments(QPainter &painter, int64_t offset, int row, int64_t
 
 	Q_UNUSED(size)
 
-	painter.setPen(palette().color(QPalette::Text));
+	painter.setPen(pen(palette().color(QPalette::Text)));
 
-	const address_t address = addressOffset_ + offset;
-	const QString comment   = commentServer_->comment(address, wordWidth_);
+	const QString &comment = rowComment(offset);
 
 	painter.drawText(
 		commentLeft(),
@@ -1045,21 +2219,26 @@ void QHexView::drawComments(QPainter &painter, int64_t offset, int row, int64_t
  * @param row_data
  */
 void QHexView::drawAsciiDumpToBuffer(QTextStream &stream, int64_t offset, int64_t size, const QByteArray &row_data) const {
+
+	Q_UNUSED(size)
+
+	QVarLengthArray<char32_t, 256> text(row_data.size());
+	QHexTextDecoder(textEncoding_).decode(reinterpret_cast<const uint8_t *>(row_data.constData()), row_data.size(), text.data());
+
+	bool selected[MaxBytesPerRow];
+	selection().mask(offset, row_data.size(), selected);
+
 	// i is the byte index
-	const int chars_per_row = bytesPerRow();
-	for (int i = 0; i < chars_per_row; ++i) {
-		const int64_t index = offset + i;
-		if (index < size) {
-			if (isSelected(index)) {
-				const auto ch        = static_cast<uint8_t>(row_data[i]);
-				const bool printable = is_printable(ch) && ch != '\f' && ch != '\t' && ch != '\r' && ch != '\n' && ch < 0x80;
-				const char byteBuffer(printable ? ch : unprintableChar_);
-				stream << byteBuffer;
-			} else {
+	for (int i = 0; i < row_data.size(); ++i) {
+		if (selected[i]) {
+			const char32_t ch = display_char(text[i]);
+			if (ch == QHexTextDecoder::Continuation) {
 				stream << ' ';
+			} else {
+				stream << glyph(ch);
 			}
 		} else {
-			break;
+			stream << ' ';
 		}
 	}
 }
@@ -1072,72 +2251,79 @@ void QHexView::drawAsciiDumpToBuffer(QTextStream &stream, int64_t offset, int64_
  */
 void QHexView::drawCommentsToBuffer(QTextStream &stream, int64_t offset, int64_t size) const {
 	Q_UNUSED(size)
-	const address_t address = addressOffset_ + offset;
-	const QString comment   = commentServer_->comment(address, wordWidth_);
-	stream << comment;
+	stream << rowComment(offset);
 }
 
 /**
- * formats bytes in a way that's suitable for rendering in a hexdump having
- * this as a separate function serves two purposes.
- * #1 no code duplication between the buffer and QPainter versions
- * #2 this encourages NRVO of the return value more than an integrated
+ * formats all of the complete words in a row of data into a flat character
+ * buffer using the formatter selected for the current word width. Each word
+ * occupies exactly charsPerWord() characters, with no separators, so word
+ * |i| can be found at buffer + (i * charsPerWord()). Having this as a
+ * separate function means there is no code duplication between the buffer
+ * and QPainter versions
  *
- * @brief QHexView::formatBytes
+ * @brief QHexView::formatRow
  * @param row_data
- * @param index
- * @return
+ * @param buffer must have room for rowWidth_ * charsPerWord() characters
+ * @return the number of words which were formatted
  */
-QString QHexView::formatBytes(const QByteArray &row_data, int index) const {
-
-	char byte_buffer[32];
-
-	static constexpr char hex_bytes[] = "000102030405060708090a0b0c0d0e0f"
-									   "101112131415161718191a1b1c1d1e1f"
-									   "202122232425262728292a2b2c2d2e2f"
-									   "303132333435363738393a3b3c3d3e3f"
-									   "404142434445464748494a4b4c4d4e4f"
-									   "505152535455565758595a5b5c5d5e5f"
-									   "606162636465666768696a6b6c6d6e6f"
-									   "707172737475767778797a7b7c7d7e7f"
-									   "808182838485868788898a8b8c8d8e8f"
-									   "909192939495969798999a9b9c9d9e9f"
-									   "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
-									   "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
-									   "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
-									   "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
-									   "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
-									   "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
-
-	switch (wordWidth_) {
-	case 1:
-		memcpy(&byte_buffer[0], &hex_bytes[(row_data[index + 0] & 0xff) * 2L], 2);
+int QHexView::formatRow(const QByteArray &row_data, char *buffer) const {
+	const int words = std::min(rowWidth_, row_data.size() / wordWidth_);
+	rowFormatter_(reinterpret_cast<const uint8_t *>(row_data.constData()), words, buffer);
+	return words;
+}
+
+/**
+ * selects the row formatter which matches the current data format, word width
+ * and byte order. This is done once whenever the settings change so that
+ * formatting a row never has to switch on any of them. Little endian words
+ * are displayed most significant byte first, so their bytes are reversed
+ *
+ * @brief QHexView::updateRowFormatter
+ */
+void QHexView::updateRowFormatter() {
+
+	const bool reverse = (byteOrder_ == LittleEndian);
+
+	switch (dataFormat_) {
+	case Binary:
+		rowFormatter_        = reverse ? select_formatter<BinaryRadix, true>(wordWidth_) : select_formatter<BinaryRadix, false>(wordWidth_);
+		layout_.charsPerWord = BinaryRadix::chars(wordWidth_);
 		break;
-	case 2:
-		memcpy(&byte_buffer[0], &hex_bytes[(row_data[index + 1] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[2], &hex_bytes[(row_data[index + 0] & 0xff) * 2L], 2);
+	case Octal:
+		rowFormatter_        = reverse ? select_formatter<OctalRadix, true>(wordWidth_) : select_formatter<OctalRadix, false>(wordWidth_);
+		layout_.charsPerWord = OctalRadix::chars(wordWidth_);
 		break;
-	case 4:
-		memcpy(&byte_buffer[0], &hex_bytes[(row_data[index + 3] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[2], &hex_bytes[(row_data[index + 2] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[4], &hex_bytes[(row_data[index + 1] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[6], &hex_bytes[(row_data[index + 0] & 0xff) * 2L], 2);
+	case UnsignedDecimal:
+		rowFormatter_        = reverse ? select_formatter<UnsignedDecimalRadix, true>(wordWidth_) : select_formatter<UnsignedDecimalRadix, false>(wordWidth_);
+		layout_.charsPerWord = UnsignedDecimalRadix::chars(wordWidth_);
 		break;
-	case 8:
-		memcpy(&byte_buffer[0], &hex_bytes[(row_data[index + 7] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[2], &hex_bytes[(row_data[index + 6] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[4], &hex_bytes[(row_data[index + 5] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[6], &hex_bytes[(row_data[index + 4] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[8], &hex_bytes[(row_data[index + 3] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[10], &hex_bytes[(row_data[index + 2] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[12], &hex_bytes[(row_data[index + 1] & 0xff) * 2L], 2);
-		memcpy(&byte_buffer[14], &hex_bytes[(row_data[index + 0] & 0xff) * 2L], 2);
+	case SignedDecimal:
+		rowFormatter_        = reverse ? select_formatter<SignedDecimalRadix, true>(wordWidth_) : select_formatter<SignedDecimalRadix, false>(wordWidth_);
+		layout_.charsPerWord = SignedDecimalRadix::chars(wordWidth_);
 		break;
-	}
+	case FloatingPoint:
+		if (wordWidth_ == 4) {
+			rowFormatter_        = reverse ? format_words<FloatRadix<float>, 4, true> : format_words<FloatRadix<float>, 4, false>;
+			layout_.charsPerWord = FloatRadix<float>::chars(wordWidth_);
+			break;
+		}
 
-	byte_buffer[wordWidth_ * 2L] = '\0';
+		if (wordWidth_ == 8) {
+			rowFormatter_        = reverse ? format_words<FloatRadix<double>, 8, true> : format_words<FloatRadix<double>, 8, false>;
+			layout_.charsPerWord = FloatRadix<double>::chars(wordWidth_);
+			break;
+		}
 
-	return QString::fromLatin1(byte_buffer);
+		// there is no floating point type for other word widths, so we just
+		// show them as hex
+		Q_FALLTHROUGH();
+	case Hexadecimal:
+	default:
+		rowFormatter_        = reverse ? select_formatter<HexRadix, true>(wordWidth_) : select_formatter<HexRadix, false>(wordWidth_);
+		layout_.charsPerWord = HexRadix::chars(wordWidth_);
+		break;
+	}
 }
 
 /**
@@ -1151,29 +2337,28 @@ void QHexView::drawHexDumpToBuffer(QTextStream &stream, int64_t offset, int64_t
 
 	Q_UNUSED(size)
 
-	// i is the word we are currently rendering
-	for (int i = 0; i < rowWidth_; ++i) {
+	const int chars_per_word = charsPerWord();
 
-		// index of first byte of current 'word'
-		const int64_t index = offset + (static_cast<int64_t>(i) * wordWidth_);
+	QVarLengthArray<char, 2048> text(rowWidth_ * chars_per_word);
 
-		// equal <=, not < because we want to test the END of the word we
-		// about to render, not the start, it's allowed to end at the very last
-		// byte
-		if (index + wordWidth_ <= size) {
-			const QString byteBuffer = formatBytes(row_data, i * wordWidth_);
+	// only complete words are formatted, a word is allowed to end at the very
+	// last byte, but not to run past it
+	const int words = formatRow(row_data, text.data());
 
-			if (isSelected(index)) {
-				stream << byteBuffer;
-			} else {
-				stream << QString(byteBuffer.length(), ' ');
-			}
+	bool selected[MaxBytesPerRow];
+	selection().mask(offset, row_data.size(), selected);
 
-			if (i != (rowWidth_ - 1)) {
-				stream << ' ';
-			}
-		} else {
-			break;
+	// i is the word we are currently rendering
+	for (int i = 0; i < words; ++i) {
+
+		if (!selected[i * wordWidth_]) {
+			std::fill_n(&text[i * chars_per_word], chars_per_word, ' ');
+		}
+
+		stream << QLatin1String(&text[i * chars_per_word], chars_per_word);
+
+		if (i != (rowWidth_ - 1)) {
+			stream << ' ';
 		}
 	}
 }
@@ -1186,74 +2371,166 @@ void QHexView::drawHexDumpToBuffer(QTextStream &stream, int64_t offset, int64_t
  * @param size
  * @param word_count
  * @param row_data
+ * @param highlights the highlight color of every byte of the row, or nullptr
  */
-void QHexView::drawHexDump(QPainter &painter, int64_t offset, int row, int64_t size, int *word_count, const QByteArray &row_data) const {
-	const int hex_dump_left = hexDumpLeft();
+void QHexView::drawHexDump(QPainter &painter, int64_t offset, int row, int64_t size, int *word_count, const QByteArray &row_data, const QRgb *highlights) const {
 
-	// i is the word we are currently rendering
-	for (int64_t i = 0; i < rowWidth_; ++i) {
-
-		// index of first byte of current 'word'
-		const int64_t index = offset + (i * wordWidth_);
-
-		// equal <=, not < because we want to test the END of the word we
-		// about to render, not the start, it's allowed to end at the very last
-		// byte
-		if (index + wordWidth_ <= size) {
-
-			const QString byteBuffer = formatBytes(row_data, i * wordWidth_);
-
-			const int drawLeft  = hex_dump_left + (i * (charsPerWord() + 1) * fontWidth_);
-			const int drawWidth = charsPerWord() * fontWidth_;
-
-			if (isSelected(index)) {
-
-				const QPalette::ColorGroup group = hasFocus() ? QPalette::Active : QPalette::Inactive;
-
-				painter.fillRect(
-					QRectF(
-						drawLeft,
-						row,
-						drawWidth,
-						fontHeight_),
-					palette().color(group, QPalette::Highlight));
-
-				// should be highlight the space between us and the next word?
-				if (i != (rowWidth_ - 1)) {
-					if (isSelected(index + 1)) {
-						painter.fillRect(
-							QRectF(
-								drawLeft + drawWidth,
-								row,
-								fontWidth_,
-								fontHeight_),
-							palette().color(group, QPalette::Highlight));
-					}
-				}
+	Q_UNUSED(size)
 
-				painter.setPen(palette().color(group, QPalette::HighlightedText));
-			} else {
-				painter.setPen(QPen((*word_count & 1) ? alternateWordColor_ : palette().color(QPalette::Text)));
+	const int hex_dump_left  = hexDumpLeft();
+	const int chars_per_word = charsPerWord();
+	const int drawWidth      = chars_per_word * fontWidth_;
+	const int cellWidth      = (chars_per_word + 1) * fontWidth_;
+	const auto bytes         = reinterpret_cast<const uint8_t *>(row_data.constData());
 
-				// implement cold zone stuff
-				if (coldZoneEnd_ > addressOffset_ && static_cast<address_t>(offset) < coldZoneEnd_ - addressOffset_) {
-					painter.setPen(QPen(coldZoneColor_));
+	const QPalette::ColorGroup group = hasFocus() ? QPalette::Active : QPalette::Inactive;
+	const bool cold_zone             = coldZoneEnd_ > addressOffset_ && static_cast<address_t>(offset) < coldZoneEnd_ - addressOffset_;
+
+	QVarLengthArray<char, 2048> text(rowWidth_ * chars_per_word);
+
+	// only complete words are formatted, a word is allowed to end at the very
+	// last byte, but not to run past it
+	const int words = formatRow(row_data, text.data());
+
+	// words which start in a hole hold no data, they are left blank
+	bool holes[MaxBytesPerRow];
+	if (holeRow(offset, row_data.size(), holes)) {
+		for (int i = 0; i < words; ++i) {
+			if (holes[i * wordWidth_]) {
+				std::fill_n(&text[i * chars_per_word], chars_per_word, ' ');
+			}
+		}
+	}
+
+	// the heatmap is indexed by the most significant byte of a word, which is
+	// the one shown first
+	const int heat_byte = (byteOrder_ == LittleEndian) ? wordWidth_ - 1 : 0;
+	const bool heatmap  = heatmapMode_ != NoHeatmap && !cold_zone;
+
+	// fills the background of the words, a run of words with the same color
+	// is filled as one rectangle, spaces in between included. A color of 0
+	// is left unfilled
+	auto fill_runs = [&](auto color_of) {
+		if (words == 0) {
+			return;
+		}
+
+		int fill_start  = 0;
+		QRgb fill_color = color_of(0);
+
+		for (int i = 1; i <= words; ++i) {
+			if (i == words || color_of(i) != fill_color) {
+				if (fill_color != 0) {
+					painter.fillRect(
+						QRectF(
+							hex_dump_left + fill_start * cellWidth,
+							row,
+							(i - fill_start) * cellWidth - fontWidth_,
+							fontHeight_),
+						QColor::fromRgba(fill_color));
+				}
+
+				if (i != words) {
+					fill_start = i;
+					fill_color = color_of(i);
 				}
 			}
+		}
+	};
+
+	// backgrounds go down before anything else, highlights over the heatmap.
+	// Selected words are simply painted over
+	if (heatmap && heatmapMode_ == HeatmapBackground) {
+		fill_runs([&](int i) { return heatmapColors_[bytes[i * wordWidth_ + heat_byte]]; });
+	}
+
+	if (highlights) {
+		fill_runs([&](int i) { return highlights[i * wordWidth_]; });
+	}
+
+	// the selection is looked up once for the whole row, one extra byte is
+	// included for deciding whether the space after the last word is selected
+	bool selected[MaxBytesPerRow + 1];
+	selection().mask(offset, row_data.size() + 1, selected);
+
+	// consecutive words which are drawn in the same color are drawn with a
+	// single call, which for most rows means one or two calls per row
+	int run_start = 0;
+	QColor run_color;
 
+	auto draw_run = [&](int run_end) {
+		if (run_end > run_start) {
+			painter.setPen(pen(run_color));
 			painter.drawText(
-				drawLeft,
+				hex_dump_left + run_start * cellWidth,
 				row,
-				byteBuffer.length() * fontWidth_,
+				(run_end - run_start) * cellWidth - fontWidth_,
 				fontHeight_,
 				Qt::AlignTop,
-				byteBuffer);
+				latin1Words(&text[run_start * chars_per_word], run_end - run_start, chars_per_word));
+		}
+		run_start = run_end;
+	};
+
+	// i is the word we are currently rendering
+	for (int i = 0; i < words; ++i) {
 
-			++(*word_count);
+		const int drawLeft = hex_dump_left + i * cellWidth;
+
+		QColor color;
+		if (selected[i * wordWidth_]) {
+
+			painter.fillRect(
+				QRectF(
+					drawLeft,
+					row,
+					drawWidth,
+					fontHeight_),
+				palette().color(group, QPalette::Highlight));
+
+			// should be highlight the space between us and the next word?
+			if (i != (rowWidth_ - 1)) {
+				if (selected[i * wordWidth_ + 1]) {
+					painter.fillRect(
+						QRectF(
+							drawLeft + drawWidth,
+							row,
+							fontWidth_,
+							fontHeight_),
+						palette().color(group, QPalette::Highlight));
+				}
+			}
+
+			color = palette().color(group, QPalette::HighlightedText);
+		} else if (cold_zone) {
+			// implement cold zone stuff
+			color = coldZoneColor_;
 		} else {
-			break;
+			color = (*word_count & 1) ? alternateWordColor_ : palette().color(QPalette::Text);
+
+			if (colorByteClasses_) {
+				const int byte_class = word_class(&bytes[i * wordWidth_], wordWidth_);
+				if (byte_class != ByteClassCount && byteClassColors_[byte_class].isValid()) {
+					color = byteClassColors_[byte_class];
+				}
+			}
+
+			if (heatmap && heatmapMode_ == HeatmapText) {
+				color = QColor::fromRgba(heatmapTextColors_[bytes[i * wordWidth_ + heat_byte]]);
+			}
+		}
+
+		if (i == 0) {
+			run_color = color;
+		} else if (color != run_color) {
+			draw_run(i);
+			run_color = color;
 		}
+
+		++(*word_count);
 	}
+
+	draw_run(words);
 }
 
 /**
@@ -1263,187 +2540,820 @@ void QHexView::drawHexDump(QPainter &painter, int64_t offset, int row, int64_t s
  * @param row
  * @param size
  * @param row_data
+ * @param highlights the highlight color of every byte of the row, or nullptr
  */
-void QHexView::drawAsciiDump(QPainter &painter, int64_t offset, int row, int64_t size, const QByteArray &row_data) const {
+void QHexView::drawAsciiDump(QPainter &painter, int64_t offset, int row, int64_t size, const QByteArray &row_data, const QRgb *highlights) const {
+
+	Q_UNUSED(size)
+
 	const int ascii_dump_left = asciiDumpLeft();
+	const auto bytes          = reinterpret_cast<const uint8_t *>(row_data.constData());
+
+	const QPalette::ColorGroup group = hasFocus() ? QPalette::Active : QPalette::Inactive;
+	const bool cold_zone             = coldZoneEnd_ > addressOffset_ && static_cast<address_t>(offset) < coldZoneEnd_ - addressOffset_;
+
+	QVarLengthArray<char32_t, 256> text(row_data.size());
+	QHexTextDecoder(textEncoding_).decode(bytes, row_data.size(), text.data());
+
+	bool selected[MaxBytesPerRow];
+	selection().mask(offset, row_data.size(), selected);
+
+	bool holes[MaxBytesPerRow];
+	const bool has_holes = holeRow(offset, row_data.size(), holes);
+
+	// highlighted bytes with the same color are filled as one rectangle
+	if (highlights) {
+		int fill_start = 0;
+		for (int i = 1; i <= row_data.size(); ++i) {
+			if (i == row_data.size() || highlights[i] != highlights[fill_start]) {
+				if (highlights[fill_start] != 0) {
+					painter.fillRect(
+						QRectF(
+							ascii_dump_left + fill_start * fontWidth_,
+							row,
+							(i - fill_start) * fontWidth_,
+							fontHeight_),
+						QColor::fromRgba(highlights[fill_start]));
+				}
+				fill_start = i;
+			}
+		}
+	}
 
 	// i is the byte index
+	for (int i = 0; i < row_data.size(); ++i) {
+
+		const char32_t ch  = display_char(text[i]);
+		const int drawLeft = ascii_dump_left + i * fontWidth_;
+
+		// drawing a selected character
+		if (selected[i]) {
+
+			painter.fillRect(
+				QRectF(
+					drawLeft,
+					row,
+					fontWidth_,
+					fontHeight_),
+				palette().color(group, QPalette::Highlight));
+
+			painter.setPen(pen(palette().color(group, QPalette::HighlightedText)));
+
+		} else if (cold_zone) {
+			// implement cold zone stuff
+			painter.setPen(pen(coldZoneColor_));
+		} else {
+			const QColor &class_color = byteClassColors_[byte_classes.classes[bytes[i]]];
+			if (colorByteClasses_ && class_color.isValid()) {
+				painter.setPen(pen(class_color));
+			} else {
+				painter.setPen(pen(ch != QHexTextDecoder::Unprintable ? palette().color(QPalette::Text) : nonPrintableTextColor_));
+			}
+		}
+
+		// the rest of a multi-byte character is drawn by its first byte, and
+		// holes hold nothing to draw
+		if (ch == QHexTextDecoder::Continuation || (has_holes && holes[i])) {
+			continue;
+		}
+
+		painter.drawText(
+			drawLeft,
+			row,
+			fontWidth_,
+			fontHeight_,
+			Qt::AlignTop,
+			glyph(ch));
+	}
+}
+
+/**
+ * @brief QHexView::holeRow
+ * @param offset
+ * @param size
+ * @param out receives whether each byte of the row is in a hole
+ * @return true if any byte of the row is in a hole, out is only filled in
+ * when the data has holes at all
+ */
+bool QHexView::holeRow(int64_t offset, int size, bool *out) const {
+
+	if (!regionData_) {
+		return false;
+	}
+
+	regionData_->holeMask(offset, size, out);
+	return std::find(out, out + size, true) != out + size;
+}
+
+/**
+ * finds the highlight color of every byte of a row, where highlights overlap
+ * the one which starts last wins
+ *
+ * @brief QHexView::highlightRow
+ * @param offset
+ * @param size
+ * @param out receives the color of each byte, 0 for bytes which aren't
+ * highlighted
+ * @return true if any byte of the row is highlighted
+ */
+bool QHexView::highlightRow(int64_t offset, int size, QRgb *out) const {
+
+	if (highlights_.isEmpty() && !structure_) {
+		return false;
+	}
+
+	std::fill_n(out, size, 0);
+
+	bool highlighted = false;
+
+	// fields of the structure are told apart by cycling through a few pale
+	// colors, explicit highlights are drawn over them
+	if (structure_) {
+		structure_->query(pageCache_.get(), offset, offset + size, byteOrder_ == BigEndian, [&](const QHexStructure::Value &value) {
+			const int64_t first = std::max(value.offset, offset);
+			const int64_t last  = std::min(value.offset + value.size, offset + size);
+			std::fill(out + (first - offset), out + (last - offset), structure_colors[value.field % std::size(structure_colors)]);
+			highlighted = true;
+		});
+	}
+
+	const address_t start = addressOffset_ + offset;
+	const address_t end   = start + size;
+
+	highlights_.query(start, end, [&](const QHexHighlights::Highlight &highlight) {
+		const address_t first = std::max<address_t>(highlight.start, start);
+		const address_t last  = std::min<address_t>(highlight.end, end);
+		std::fill(out + (first - start), out + (last - start), highlight.color);
+		highlighted = true;
+	});
+
+	return highlighted;
+}
+
+/**
+ * @brief QHexView::hasComments
+ * @return true if there is anything to show in the comment column
+ */
+bool QHexView::hasComments() const {
+	return commentServer_ || structure_;
+}
+
+/**
+ * the comment for a row is the fields of the structure which start in it if
+ * there is a structure, otherwise whatever the comment server says. The
+ * result is only valid until the next call
+ *
+ * @brief QHexView::rowComment
+ * @param offset of the first byte of the row
+ * @return
+ */
+const QString &QHexView::rowComment(int64_t offset) const {
+
+	QString &comment = scratch_.comment;
+
+	if (!structure_) {
+		comment = commentServer_->comment(addressOffset_ + offset, wordWidth_);
+		return comment;
+	}
+
+	const int64_t end = offset + bytesPerRow();
+
+	// resizing rather than clearing keeps the capacity
+	comment.resize(0);
+	structure_->query(pageCache_.get(), offset, end, byteOrder_ == BigEndian, [&](const QHexStructure::Value &value) {
+		if (value.offset >= offset) {
+			if (!comment.isEmpty()) {
+				comment += QLatin1String("  ");
+			}
+			comment += value.text;
+		}
+	});
+
+	return comment;
+}
+
+/**
+ * draws the line standing in for a run of rows which are identical to the
+ * row above it
+ *
+ * @brief QHexView::drawRepeatMarker
+ * @param painter
+ * @param row
+ * @param repeats
+ */
+void QHexView::drawRepeatMarker(QPainter &painter, int row, int64_t repeats) const {
+
+	// the text is translated once, and the count put in place of its "%1"
+	// without building a string for it
+	QString &format = scratch_.markerFormat;
+	if (format.isEmpty()) {
+		format = tr("* %1 identical rows");
+	}
+
+	char digits[24];
+	const int length = static_cast<int>(std::to_chars(digits, digits + sizeof(digits), repeats).ptr - digits);
+
+	const int position = format.indexOf(QLatin1String("%1"));
+
+	QString &text = scratch_.marker;
+	text.resize(0);
+	if (position == -1) {
+		text.append(format);
+	} else {
+		text.append(format.constData(), position);
+		text.append(QLatin1String(digits, length));
+		text.append(format.constData() + position + 2, format.size() - position - 2);
+	}
+
+	painter.setPen(pen(palette().color(QPalette::Disabled, QPalette::Text)));
+	painter.drawText(hexDumpLeft(), row, text.size() * fontWidth_, fontHeight_, Qt::AlignTop, text);
+}
+
+/**
+ * characters are drawn one at a time, so we keep the string for every
+ * character we have seen around rather than building one for each cell
+ *
+ * @brief QHexView::glyph
+ * @param ch a character produced by QHexTextDecoder
+ * @return the string to draw for the character
+ */
+const QString &QHexView::glyph(char32_t ch) const {
+	auto it = glyphCache_.find(ch);
+	if (it == glyphCache_.end()) {
+		if (ch == QHexTextDecoder::Unprintable) {
+			it = glyphCache_.insert(ch, QString(QChar(unprintableChar_)));
+		} else {
+			const uint ucs4 = ch;
+			it              = glyphCache_.insert(ch, QString::fromUcs4(&ucs4, 1));
+		}
+	}
+	return *it;
+}
+
+/**
+ * converts text into a string which is reused for every call, the result is
+ * only valid until the next call
+ *
+ * @brief QHexView::latin1Text
+ * @param text
+ * @param length
+ * @return
+ */
+const QString &QHexView::latin1Text(const char *text, int length) const {
+	QString &str = scratch_.text;
+	str.resize(length);
+
+	QChar *const out = str.data();
+	for (int i = 0; i < length; ++i) {
+		out[i] = QLatin1Char(text[i]);
+	}
+
+	return str;
+}
+
+/**
+ * converts count words of chars_per_word characters each into a string with
+ * the words separated by spaces, like latin1Text the result is only valid
+ * until the next call
+ *
+ * @brief QHexView::latin1Words
+ * @param text
+ * @param count
+ * @param chars_per_word
+ * @return
+ */
+const QString &QHexView::latin1Words(const char *text, int count, int chars_per_word) const {
+	QString &str = scratch_.text;
+	str.resize(count * (chars_per_word + 1) - 1);
+
+	QChar *out = str.data();
+	for (int i = 0; i < count; ++i) {
+		if (i != 0) {
+			*out++ = QLatin1Char(' ');
+		}
+
+		for (int j = 0; j < chars_per_word; ++j) {
+			*out++ = QLatin1Char(*text++);
+		}
+	}
+
+	return str;
+}
+
+/**
+ * constructing a QPen allocates, so we keep one around for every color we
+ * have drawn with
+ *
+ * @brief QHexView::pen
+ * @param color
+ * @return
+ */
+const QPen &QHexView::pen(const QColor &color) const {
+
+	// we only expect a handful of colors, but don't let a caller which keeps
+	// changing them grow this forever
+	if (scratch_.pens.size() > 1024) {
+		scratch_.pens.clear();
+	}
+
+	auto it = scratch_.pens.find(color.rgba());
+	if (it == scratch_.pens.end()) {
+		it = scratch_.pens.insert(color.rgba(), QPen(color));
+	}
+	return *it;
+}
+
+/**
+ * reads a row of data into a buffer which is reused for every call, the
+ * result is only valid until the next call
+ *
+ * @brief QHexView::readRow
+ * @param offset
+ * @param size
+ * @return
+ */
+const QByteArray &QHexView::readRow(int64_t offset, int size) const {
+	QByteArray &row = scratch_.row;
+	row.resize(size);
+
+	row.resize(pageCache_ ? static_cast<int>(pageCache_->read(offset, row.data(), size)) : 0);
+	return row;
+}
+
+/**
+ * @brief QHexView::paintEvent
+ * @param event
+ */
+void QHexView::paintEvent(QPaintEvent *event) {
+
+	Q_UNUSED(event)
+	QPainter painter(viewport());
+	painter.translate(-horizontalScrollBar()->value() * fontWidth_, 0);
+
+	int word_count = 0;
+
+	// pixel offset of this row
+	int row = 0;
+
 	const int chars_per_row = bytesPerRow();
-	for (int i = 0; i < chars_per_row; ++i) {
 
-		const int64_t index = offset + i;
+	// the line at the top of the view, lines and rows only differ when
+	// collapsing repeated rows
+	int64_t line = verticalScrollBar()->value();
 
-		if (index < size) {
-			const char ch        = row_data[i];
-			const int drawLeft   = ascii_dump_left + i * fontWidth_;
-			const bool printable = is_printable(ch);
+	// current actual offset (in bytes), we do this manually because we have the else
+	// case unlike the helper function
+	int64_t offset = collapseRepeatedRows_ ? repeatIndex_.line(line).row * chars_per_row : line * chars_per_row;
 
-			// drawing a selected character
-			if (isSelected(index)) {
+	if (origin_ != 0) {
+		if (offset > 0) {
+			offset += origin_;
+			offset -= chars_per_row;
+		} else {
+			origin_ = 0;
+			updateScrollbars();
+		}
+	}
 
-				const QPalette::ColorGroup group = hasFocus() ? QPalette::Active : QPalette::Inactive;
+	const int64_t data_size    = dataSize();
+	const int64_t first_offset = offset;
+	const int widget_height    = height();
 
-				painter.fillRect(
-					QRectF(
-						drawLeft,
-						row,
-						fontWidth_,
-						fontHeight_),
-					palette().color(group, QPalette::Highlight));
+	char address_buffer[AddressFormatter::MaxLength];
+	AddressFormatter address_formatter(layout_.address);
+	address_formatter.reset(addressOffset_ + offset);
 
-				painter.setPen(palette().color(group, QPalette::HighlightedText));
+	QRgb highlight_colors[MaxBytesPerRow];
 
-			} else {
-				painter.setPen(QPen(printable ? palette().color(QPalette::Text) : nonPrintableTextColor_));
+	// read everything on screen at once rather than a page at a time, collapsed
+	// rows don't know where the screen ends until they are drawn
+	if (pageCache_ && !collapseRepeatedRows_) {
+		pageCache_->fetch(first_offset, static_cast<int64_t>(widget_height / fontHeight_ + 1) * chars_per_row);
+	}
+
+	while (row + fontHeight_ < widget_height && offset < data_size) {
+
+		// a marker stands in for the rows after it, the next line picks up
+		// after the last of them
+		if (collapseRepeatedRows_) {
+			const QHexRepeatIndex::Line current = repeatIndex_.line(line++);
+			if (current.repeats != 0) {
+				drawRepeatMarker(painter, row, current.repeats);
+				offset = (current.row + current.repeats) * chars_per_row;
+				row += fontHeight_;
+				address_formatter.reset(addressOffset_ + offset);
+				continue;
+			}
+		}
+
+		const QByteArray &row_data = readRow(offset, chars_per_row);
+
+		if (!row_data.isEmpty()) {
+			if (showAddress_) {
+				const int address_length = address_formatter.write(address_buffer);
+				painter.setPen(pen(addressColor_));
 
 				// implement cold zone stuff
 				if (coldZoneEnd_ > addressOffset_ && static_cast<address_t>(offset) < coldZoneEnd_ - addressOffset_) {
-					painter.setPen(QPen(coldZoneColor_));
+					painter.setPen(pen(coldZoneColor_));
 				}
+
+				painter.drawText(0, row, address_length * fontWidth_, fontHeight_, Qt::AlignTop, latin1Text(address_buffer, address_length));
 			}
 
-			const QString byteBuffer(printable ? ch : unprintableChar_);
+			const bool highlighted = highlightRow(offset, row_data.size(), highlight_colors);
 
-			painter.drawText(
-				drawLeft,
-				row,
-				fontWidth_,
-				fontHeight_,
-				Qt::AlignTop,
-				byteBuffer);
-		} else {
-			break;
+			if (showHex_) {
+				drawHexDump(painter, offset, row, data_size, &word_count, row_data, highlighted ? highlight_colors : nullptr);
+			}
+
+			if (showAscii_) {
+				drawAsciiDump(painter, offset, row, data_size, row_data, highlighted ? highlight_colors : nullptr);
+			}
+
+			if (showComments_ && hasComments()) {
+				drawComments(painter, offset, row, data_size);
+			}
+		}
+
+		offset += chars_per_row;
+		row += fontHeight_;
+		address_formatter.advance(chars_per_row);
+	}
+
+	// have what a page up or a page down would show read while idle
+	if (pageCache_) {
+		const int64_t shown = offset - first_offset;
+		pageCache_->prefetch(first_offset - shown, shown);
+		pageCache_->prefetch(offset, shown);
+	}
+
+	painter.setPen(palette().color(hasFocus() ? QPalette::Active : QPalette::Inactive, QPalette::WindowText));
+
+	if (showAddress_ && showLine1_) {
+		const int vertline1_x = line1();
+		painter.drawLine(vertline1_x, 0, vertline1_x, widget_height);
+	}
+
+	if (showHex_ && showLine2_) {
+		const int vertline2_x = line2();
+		painter.drawLine(vertline2_x, 0, vertline2_x, widget_height);
+	}
+
+	if (showAscii_ && showLine3_) {
+		const int vertline3_x = line3();
+		painter.drawLine(vertline3_x, 0, vertline3_x, widget_height);
+	}
+}
+
+/**
+ * @brief QHexView::selectAll
+ */
+void QHexView::selectAll() {
+	previousSelection_.clear();
+	columnSelection_ = false;
+	selectionStart_  = 0;
+	selectionEnd_    = dataSize();
+	updateSelection();
+}
+
+/**
+ * @brief QHexView::deselect
+ */
+void QHexView::deselect() {
+	previousSelection_.clear();
+	selectionStart_ = -1;
+	selectionEnd_   = -1;
+	updateSelection();
+}
+
+/**
+ * rebuilds the selection from the ranges which were selected before the
+ * current one was started and the current one itself, which is either the
+ * bytes between selectionStart_ and selectionEnd_ or the block of columns
+ * with those two bytes as its corners
+ *
+ * @brief QHexView::updateSelection
+ */
+void QHexView::updateSelection() {
+
+	QHexSelection selection = previousSelection_;
+
+	auto publish = [this](QHexSelection selection) {
+		changingSelection_ = true;
+		selectionModel_->setSelection(std::move(selection));
+		changingSelection_ = false;
+	};
+
+	if (selectionStart_ == -1 || selectionEnd_ == -1) {
+		publish(std::move(selection));
+		return;
+	}
+
+	const int64_t data_size = dataSize();
+
+	if (!columnSelection_) {
+		const int64_t start = std::max<int64_t>(std::min(selectionStart_, selectionEnd_), 0);
+		const int64_t end   = std::min(std::max(selectionStart_, selectionEnd_), data_size);
+		selection.add(start, end);
+		publish(std::move(selection));
+		return;
+	}
+
+	// rows start at origin_ rather than at a multiple of the row size, so
+	// the corners are made relative to that first
+	const int bpr         = bytesPerRow();
+	const int64_t phase   = static_cast<int64_t>(origin_ % bpr);
+	const int64_t first   = selectionStart_ - phase;
+	const int64_t second  = ((selectionEnd_ > selectionStart_) ? selectionEnd_ - 1 : selectionEnd_) - phase;
+	const int64_t row1    = (first >= 0) ? first / bpr : -((bpr - 1 - first) / bpr);
+	const int64_t row2    = (second >= 0) ? second / bpr : -((bpr - 1 - second) / bpr);
+	const int64_t column1 = first - row1 * bpr;
+	const int64_t column2 = second - row2 * bpr;
+
+	// whole words are selected
+	const int64_t left  = std::min(column1, column2) / wordWidth_ * wordWidth_;
+	const int64_t right = std::min<int64_t>((std::max(column1, column2) / wordWidth_ + 1) * wordWidth_, bpr);
+
+	for (int64_t row = std::min(row1, row2); row <= std::max(row1, row2); ++row) {
+		const int64_t row_start = phase + row * bpr;
+		selection.add(std::max<int64_t>(row_start + left, 0), std::min(row_start + right, data_size));
+	}
+
+	publish(std::move(selection));
+}
+
+/**
+ * shares the selection with other views which use the same model, the view
+ * does not take ownership of it
+ *
+ * @brief QHexView::setSelectionModel
+ * @param model
+ */
+void QHexView::setSelectionModel(QHexSelectionModel *model) {
+
+	if (selectionModel_) {
+		disconnect(selectionModel_, nullptr, this, nullptr);
+	}
+
+	selectionModel_ = model;
+	connect(selectionModel_, &QHexSelectionModel::selectionChanged, this, &QHexView::selectionModelChanged);
+	selectionModelChanged();
+}
+
+/**
+ * @brief QHexView::selectionModelChanged
+ */
+void QHexView::selectionModelChanged() {
+
+	// a selection made in another view leaves nothing here to extend
+	if (!changingSelection_) {
+		previousSelection_.clear();
+		selectionStart_ = -1;
+		selectionEnd_   = -1;
+	}
+
+	updateToolTip();
+	viewport()->update();
+}
+
+/**
+ * reads all of the data into memory at once, allBytesReader can process
+ * large data without doing that
+ *
+ * @brief QHexView::allBytes
+ * @return
+ */
+QByteArray QHexView::allBytes() const {
+	if (!data_) {
+		return QByteArray();
+	}
+
+	data_->seek(0);
+	return data_->readAll();
+}
+
+/**
+ * reads the whole selection into memory at once, selectedBytesReader can
+ * process large selections without doing that
+ *
+ * @brief QHexView::selectedBytes
+ * @return
+ */
+QByteArray QHexView::selectedBytes() const {
+	QByteArray bytes;
+	if (!data_) {
+		return bytes;
+	}
+
+	// when more than one range is selected, their bytes follow each other
+	for (const QHexSelection::Range &range : selection().ranges()) {
+		data_->seek(range.start);
+		bytes += data_->read(range.end - range.start);
+	}
+
+	return bytes;
+}
+
+/**
+ * @brief QHexView::allBytesReader
+ * @param chunk_size
+ * @return a reader which goes over all of the data a chunk at a time
+ */
+QHexRangeReader QHexView::allBytesReader(int chunk_size) const {
+	return QHexRangeReader(data_, {QHexSelection::Range{0, dataSize()}}, chunk_size);
+}
+
+/**
+ * @brief QHexView::selectedBytesReader
+ * @param chunk_size
+ * @return a reader which goes over the selected ranges a chunk at a time,
+ * in the same order as selectedBytes
+ */
+QHexRangeReader QHexView::selectedBytesReader(int chunk_size) const {
+	// the selection may come from another view of a model this view shares
+	// when it has no data of its own
+	return QHexRangeReader(data_, data_ ? selection().ranges() : std::vector<QHexSelection::Range>(), chunk_size);
+}
+
+/**
+ * writes all of the data to a file. When the data is a local file the
+ * kernel copies it directly, see QHexFileCopy
+ *
+ * @brief QHexView::saveAll
+ * @param filename
+ * @param error receives a description of the problem if saving fails
+ * @return true on success
+ */
+bool QHexView::saveAll(const QString &filename, QString *error) const {
+	if (!data_) {
+		if (error) {
+			*error = tr("there is no data to save");
+		}
+		return false;
+	}
+
+	return QHexFileCopy::copy(data_, {QHexSelection::Range{0, dataSize()}}, filename, error);
+}
+
+/**
+ * writes the selected ranges, one after the other, to a file. When the data
+ * is a local file the kernel copies it directly, see QHexFileCopy
+ *
+ * @brief QHexView::saveSelection
+ * @param filename
+ * @param error receives a description of the problem if saving fails
+ * @return true on success
+ */
+bool QHexView::saveSelection(const QString &filename, QString *error) const {
+	if (!data_) {
+		if (error) {
+			*error = tr("there is no data to save");
 		}
+		return false;
 	}
+
+	return QHexFileCopy::copy(data_, selection().ranges(), filename, error);
 }
 
 /**
- * @brief QHexView::paintEvent
- * @param event
+ * @brief QHexView::isEditable
+ * @return true if pasting can change the data, only data held in memory can
+ * grow by inserting
  */
-void QHexView::paintEvent(QPaintEvent *event) {
-
-	Q_UNUSED(event)
-	QPainter painter(viewport());
-	painter.translate(-horizontalScrollBar()->value() * fontWidth_, 0);
-
-	int word_count = 0;
-
-	// pixel offset of this row
-	int row = 0;
-
-	const int chars_per_row = bytesPerRow();
-
-	// current actual offset (in bytes), we do this manually because we have the else
-	// case unlike the helper function
-	int64_t offset = static_cast<int64_t>(verticalScrollBar()->value()) * chars_per_row;
+bool QHexView::isEditable() const {
+	return data_ && (data_ == internalBuffer_.get() || data_->isWritable());
+}
 
-	if (origin_ != 0) {
-		if (offset > 0) {
-			offset += origin_;
-			offset -= chars_per_row;
-		} else {
-			origin_ = 0;
-			updateScrollbars();
+/**
+ * decodes hex text, such as "de ad be ef", the output of xxd or hexdump -C,
+ * a C array or what mnuCopy puts on the clipboard, and writes the bytes at
+ * the start of the selection. Words as wide as the current word width are
+ * read in the current byte order, so copying and pasting in the same view
+ * gives back the same bytes. The data has to be shown in hexadecimal, the
+ * other formats can't be read back. The pasted bytes are selected afterwards.
+ * When overwriting, text holding more bytes than there are from the start of
+ * the selection to the end of the data is an error
+ *
+ * @brief QHexView::pasteHex
+ * @param text
+ * @param mode whether the bytes replace the selected ones or are inserted
+ * before them, inserting needs the data to be held in memory
+ * @param error receives a description of the problem if pasting fails
+ * @return true on success
+ */
+bool QHexView::pasteHex(const QString &text, PasteMode mode, QString *error) {
+
+	auto fail = [error](const QString &message) {
+		if (error) {
+			*error = message;
 		}
-	}
+		return false;
+	};
 
-	const int64_t data_size = dataSize();
-	const int widget_height = height();
+	if (!isEditable()) {
+		return fail(tr("the data can't be changed"));
+	}
 
-	while (row + fontHeight_ < widget_height && offset < data_size) {
+	// text copied from the other data formats would be read as different bytes
+	if (dataFormat_ != Hexadecimal) {
+		return fail(tr("text can only be pasted while the data is shown in hexadecimal"));
+	}
 
-		data_->seek(offset);
-		const QByteArray row_data = data_->read(chars_per_row);
+	const int64_t offset = selection().start();
+	if (offset == -1) {
+		return fail(tr("nothing is selected"));
+	}
 
-		if (!row_data.isEmpty()) {
-			if (showAddress_) {
-				const address_t address_rva = addressOffset_ + offset;
-				const QString addressBuffer = formatAddress(address_rva);
-				painter.setPen(QPen(addressColor_));
+	auto buffer = qobject_cast<QBuffer *>(data_);
+	if (mode == PasteInsert && !buffer) {
+		return fail(tr("bytes can only be inserted into data held in memory"));
+	}
 
-				// implement cold zone stuff
-				if (coldZoneEnd_ > addressOffset_ && static_cast<address_t>(offset) < coldZoneEnd_ - addressOffset_) {
-					painter.setPen(QPen(coldZoneColor_));
-				}
+	QHexCodec::HexOptions options;
+	options.wordWidth        = wordWidth_;
+	options.littleEndian     = byteOrder_ == LittleEndian;
+	options.addressColumn    = showAddress_;
+	options.decimalAddresses = decimalAddresses_;
 
-				painter.drawText(0, row, addressBuffer.length() * fontWidth_, fontHeight_, Qt::AlignTop, addressBuffer);
-			}
+	// overwriting never grows the data, and data in memory can't grow past
+	// what a QByteArray holds
+	options.maxSize = (mode == PasteInsert) ? INT_MAX - buffer->size() : dataSize() - offset;
 
-			if (showHex_) {
-				drawHexDump(painter, offset, row, data_size, &word_count, row_data);
-			}
+	const QByteArray latin1 = text.toLatin1();
 
-			if (showAscii_) {
-				drawAsciiDump(painter, offset, row, data_size, row_data);
-			}
+	QByteArray bytes;
+	if (!QHexCodec::decodeHex(latin1.constData(), latin1.size(), options, &bytes, error)) {
+		return false;
+	}
 
-			if (showComments_ && commentServer_) {
-				drawComments(painter, offset, row, data_size);
-			}
+	const int64_t size = bytes.size();
+	if (mode == PasteInsert) {
+		buffer->buffer().insert(static_cast<int>(offset), bytes);
+	} else {
+		if (buffer) {
+			buffer->buffer().replace(static_cast<int>(offset), static_cast<int>(size), bytes.constData(), static_cast<int>(size));
+		} else if (!data_->seek(offset) || data_->write(bytes.constData(), size) != size) {
+			return fail(data_->errorString());
 		}
-
-		offset += chars_per_row;
-		row += fontHeight_;
 	}
 
-	painter.setPen(palette().color(hasFocus() ? QPalette::Active : QPalette::Inactive, QPalette::WindowText));
-
-	if (showAddress_ && showLine1_) {
-		const int vertline1_x = line1();
-		painter.drawLine(vertline1_x, 0, vertline1_x, widget_height);
-	}
+	pageCache_->invalidate();
+	knownSize_ = dataSize();
+	repeatIndex_.clear();
 
-	if (showHex_ && showLine2_) {
-		const int vertline2_x = line2();
-		painter.drawLine(vertline2_x, 0, vertline2_x, widget_height);
-	}
+	resetStructure();
 
-	if (showAscii_ && showLine3_) {
-		const int vertline3_x = line3();
-		painter.drawLine(vertline3_x, 0, vertline3_x, widget_height);
-	}
-}
+	previousSelection_.clear();
+	columnSelection_ = false;
+	selectionStart_  = offset;
+	selectionEnd_    = offset + size;
+	updateSelection();
 
-/**
- * @brief QHexView::selectAll
- */
-void QHexView::selectAll() {
-	selectionStart_ = 0;
-	selectionEnd_   = dataSize();
+	updateLayout();
+	viewport()->update();
+	return true;
 }
 
 /**
- * @brief QHexView::deselect
+ * writes the selected ranges, one after the other, to a device in one of
+ * the export formats. The selection is read and encoded a chunk at a time,
+ * so a selection of any size can be exported to a file
+ *
+ * @brief QHexView::exportSelection
+ * @param format
+ * @param out
+ * @param error receives a description of the problem if exporting fails
+ * @return true on success
  */
-void QHexView::deselect() {
-	selectionStart_ = -1;
-	selectionEnd_   = -1;
+bool QHexView::exportSelection(QHexCodec::ExportFormat format, QIODevice *out, QString *error) const {
+	QHexRangeReader reader = selectedBytesReader();
+	return QHexCodec::encode(reader, format, addressOffset_, out, error);
 }
 
 /**
- * @brief QHexView::allBytes
- * @return
+ * puts the selection on the clipboard in one of the export formats
+ *
+ * @brief QHexView::copySelectionAs
+ * @param format
  */
-QByteArray QHexView::allBytes() const {
-	data_->seek(0);
-	return data_->readAll();
-}
+void QHexView::copySelectionAs(QHexCodec::ExportFormat format) {
+	if (!hasSelectedText()) {
+		return;
+	}
 
-/**
- * @brief QHexView::selectedBytes
- * @return
- */
-QByteArray QHexView::selectedBytes() const {
-	if (hasSelectedText()) {
-		const int64_t s = std::min(selectionStart_, selectionEnd_);
-		const int64_t e = std::max(selectionStart_, selectionEnd_);
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
 
-		data_->seek(s);
-		return data_->read(e - s);
+	QString error;
+	if (!exportSelection(format, &buffer, &error)) {
+		QMessageBox::warning(this, tr("Copy Selection As"), tr("Could not copy the selection: %1").arg(error));
+		return;
 	}
 
-	return QByteArray();
+	const QString s = QString::fromLatin1(buffer.data());
+	QApplication::clipboard()->setText(s);
+	QApplication::clipboard()->setText(s, QClipboard::Selection);
 }
 
 /**
@@ -1451,7 +3361,7 @@ QByteArray QHexView::selectedBytes() const {
  * @return
  */
 auto QHexView::selectedBytesAddress() const -> address_t {
-	const address_t select_base = std::min(selectionStart_, selectionEnd_);
+	const address_t select_base = selection().start();
 	return select_base + addressOffset_;
 }
 
@@ -1460,15 +3370,7 @@ auto QHexView::selectedBytesAddress() const -> address_t {
  * @return
  */
 uint64_t QHexView::selectedBytesSize() const {
-
-	int64_t ret;
-	if (selectionEnd_ > selectionStart_) {
-		ret = selectionEnd_ - selectionStart_;
-	} else {
-		ret = selectionStart_ - selectionEnd_;
-	}
-
-	return ret;
+	return selection().size();
 }
 
 /**
@@ -1543,6 +3445,7 @@ auto QHexView::firstVisibleAddress() const -> address_t {
  */
 void QHexView::setAddressSize(AddressSize address_size) {
 	addressSize_ = address_size;
+	updateLayout();
 	viewport()->update();
 }
 
@@ -1620,6 +3523,64 @@ QColor QHexView::alternateWordColor() const {
 	return alternateWordColor_;
 }
 
+/**
+ * @brief QHexView::byteClassColor
+ * @param byteClass
+ * @return
+ */
+QColor QHexView::byteClassColor(ByteClass byteClass) const {
+	Q_ASSERT(byteClass >= 0 && byteClass < ByteClassCount);
+	return byteClassColors_[byteClass];
+}
+
+/**
+ * @brief QHexView::collapseRepeatedRows
+ * @return
+ */
+bool QHexView::collapseRepeatedRows() const {
+	return collapseRepeatedRows_;
+}
+
+/**
+ * @brief QHexView::decompressGzip
+ * @return
+ */
+bool QHexView::decompressGzip() const {
+	return decompressGzip_;
+}
+
+/**
+ * @brief QHexView::colorByteClasses
+ * @return
+ */
+bool QHexView::colorByteClasses() const {
+	return colorByteClasses_;
+}
+
+/**
+ * @brief QHexView::heatmapMode
+ * @return
+ */
+QHexView::HeatmapMode QHexView::heatmapMode() const {
+	return heatmapMode_;
+}
+
+/**
+ * @brief QHexView::heatmapLowColor
+ * @return
+ */
+QColor QHexView::heatmapLowColor() const {
+	return heatmapLowColor_;
+}
+
+/**
+ * @brief QHexView::heatmapHighColor
+ * @return
+ */
+QColor QHexView::heatmapHighColor() const {
+	return heatmapHighColor_;
+}
+
 /**
  * @brief QHexView::nonPrintableTextColor
  * @return
@@ -1659,3 +3620,283 @@ void QHexView::setAlternateWordColor(const QColor &color) {
 void QHexView::setNonPrintableTextColor(const QColor &color) {
 	nonPrintableTextColor_ = color;
 }
+
+/**
+ * sets the color used for bytes of the given class in both the hex and text
+ * columns. An invalid color leaves the class drawn the way it would be
+ * without byte class coloring
+ *
+ * @brief QHexView::setByteClassColor
+ * @param byteClass
+ * @param color
+ */
+void QHexView::setByteClassColor(ByteClass byteClass, const QColor &color) {
+	Q_ASSERT(byteClass >= 0 && byteClass < ByteClassCount);
+	byteClassColors_[byteClass] = color;
+	viewport()->update();
+}
+
+/**
+ * sets whether gzip compressed data is shown decompressed, which needs the
+ * library to be built with zlib. Takes effect from the next setData
+ *
+ * @brief QHexView::setDecompressGzip
+ * @param value
+ */
+void QHexView::setDecompressGzip(bool value) {
+	decompressGzip_ = value;
+}
+
+/**
+ * shows runs of identical rows as their first row followed by a single
+ * marker line. Runs are found in the background, so on large data the view
+ * keeps getting shorter for a while after this is turned on
+ *
+ * @brief QHexView::setCollapseRepeatedRows
+ * @param value
+ */
+void QHexView::setCollapseRepeatedRows(bool value) {
+	const int64_t first_visible = normalizedOffset();
+	collapseRepeatedRows_       = value;
+	updateLayout();
+	scrollTo(first_visible);
+}
+
+/**
+ * starts looking for repeated rows again if what was found so far no longer
+ * matches the data or the row size
+ *
+ * @brief QHexView::updateRepeatIndex
+ */
+void QHexView::updateRepeatIndex() {
+	if (!collapseRepeatedRows_) {
+		repeatIndex_.clear();
+		repeatIndexTimer_->stop();
+	} else if (repeatIndex_.bytesPerRow() != bytesPerRow()) {
+		repeatIndex_.reset(dataSize(), bytesPerRow());
+		repeatIndexTimer_->start(0);
+	} else if (repeatIndex_.size() != dataSize()) {
+		// data which grows keeps the runs found so far
+		repeatIndex_.resize(dataSize());
+		repeatIndexTimer_->start(0);
+	}
+}
+
+/**
+ * called when data which is still being read for the first time, such as a
+ * gzip file, turns out to be bigger than it was
+ *
+ * @brief QHexView::dataSizeChanged
+ */
+void QHexView::dataSizeChanged() {
+
+	const int64_t old_size = knownSize_;
+	knownSize_             = data_->size();
+
+	if (knownSize_ > Q_INT64_C(0xffffffff)) {
+		addressSize_ = Address64;
+	}
+
+	// only the page holding the old end was cut short by it, the rest of
+	// what is cached, possibly by other views of the data, is still good
+	const int64_t last_page = old_size / QHexPageCache::PageSize * QHexPageCache::PageSize;
+	pageCache_->invalidate(last_page, QHexPageCache::PageSize);
+
+	// so may have been the last records of the structure, the rest are
+	// found by carrying on from there
+	if (structure_) {
+		structure_->grow(old_size);
+		structureTimer_->start(0);
+	}
+
+	updateLayout();
+	viewport()->update();
+}
+
+/**
+ * looks at the next slice of the data for repeated rows, called whenever the
+ * event loop is idle until all of the data has been looked at
+ *
+ * @brief QHexView::scanRepeatedRows
+ */
+void QHexView::scanRepeatedRows() {
+	const int64_t first_row = repeatIndex_.line(verticalScrollBar()->value()).row;
+	const int64_t lines     = repeatIndex_.lineCount();
+
+	if (!data_ || repeatIndex_.scan(data_, repeat_scan_bytes)) {
+		repeatIndexTimer_->stop();
+	}
+
+	if (repeatIndex_.lineCount() != lines) {
+		// rows above the view may have collapsed, keep showing the same data
+		updateScrollbars();
+		verticalScrollBar()->setValue(repeatIndex_.lineForRow(first_row));
+		viewport()->update();
+	}
+}
+
+/**
+ * forgets what the structure read from the data, and starts finding where
+ * its records are again
+ *
+ * @brief QHexView::resetStructure
+ */
+void QHexView::resetStructure() {
+	if (structure_) {
+		structure_->invalidate();
+		structureTimer_->start(0);
+	}
+}
+
+/**
+ * finds where the next slice of the records of the structure start, called
+ * whenever the event loop is idle until all of them have been found. Rows
+ * which were drawn before their records were found are drawn again
+ *
+ * @brief QHexView::scanStructure
+ */
+void QHexView::scanStructure() {
+
+	if (!structure_ || !pageCache_) {
+		structureTimer_->stop();
+		return;
+	}
+
+	const bool waiting = structure_->isWaiting();
+
+	if (structure_->scan(pageCache_.get(), byteOrder_ == BigEndian)) {
+		structureTimer_->stop();
+	}
+
+	if (waiting) {
+		viewport()->update();
+	}
+}
+
+/**
+ * @brief QHexView::setColorByteClasses
+ * @param value
+ */
+void QHexView::setColorByteClasses(bool value) {
+	colorByteClasses_ = value;
+	viewport()->update();
+}
+
+/**
+ * @brief QHexView::setHeatmapMode
+ * @param mode
+ */
+void QHexView::setHeatmapMode(HeatmapMode mode) {
+	heatmapMode_ = mode;
+	viewport()->update();
+}
+
+/**
+ * sets the ends of the heatmap gradient, byte values in between are given
+ * a color interpolated between the two. The gradient is computed once here
+ * so that painting only has to look colors up
+ *
+ * @brief QHexView::setHeatmapColors
+ * @param low the color of 0x00
+ * @param high the color of 0xff
+ */
+void QHexView::setHeatmapColors(const QColor &low, const QColor &high) {
+	heatmapLowColor_  = low;
+	heatmapHighColor_ = high;
+
+	for (int i = 0; i < 256; ++i) {
+		const QColor color(
+			low.red() + (high.red() - low.red()) * i / 255,
+			low.green() + (high.green() - low.green()) * i / 255,
+			low.blue() + (high.blue() - low.blue()) * i / 255);
+
+		heatmapColors_[i]     = color.rgba();
+		heatmapTextColors_[i] = color.darker(200).rgba();
+	}
+
+	viewport()->update();
+}
+
+/**
+ * highlights the addresses [start, end) with a background color in both the
+ * hex and text columns, the label is shown in the tooltip of a selection
+ * starting within the range
+ *
+ * @brief QHexView::addHighlight
+ * @param start
+ * @param end
+ * @param color
+ * @param label
+ * @return an id which can be passed to removeHighlight
+ */
+int QHexView::addHighlight(address_t start, address_t end, const QColor &color, const QString &label) {
+	const int id = highlights_.add(QHexHighlights::Highlight{start, end, color.rgba(), label});
+	viewport()->update();
+	return id;
+}
+
+/**
+ * adds many highlights at once, which is far faster than calling
+ * addHighlight for each of them
+ *
+ * @brief QHexView::addHighlights
+ * @param highlights
+ * @return the id of the first highlight, the rest have the ids which follow
+ */
+int QHexView::addHighlights(std::vector<QHexHighlights::Highlight> highlights) {
+	const int id = highlights_.add(std::move(highlights));
+	viewport()->update();
+	return id;
+}
+
+/**
+ * @brief QHexView::removeHighlight
+ * @param id
+ */
+void QHexView::removeHighlight(int id) {
+	highlights_.remove(id);
+	viewport()->update();
+}
+
+/**
+ * @brief QHexView::clearHighlights
+ */
+void QHexView::clearHighlights() {
+	highlights_.clear();
+	viewport()->update();
+}
+
+/**
+ * lays count records of the structure described by declaration out in a row,
+ * starting at address. Each field is shaded and shown in the comment column
+ * of the row it starts in. Records are only read as they scroll into view,
+ * see QHexStructure for the syntax
+ *
+ * @brief QHexView::setStructure
+ * @param declaration
+ * @param address
+ * @param count
+ * @param error receives a description of the problem if declaration is invalid
+ * @return true if the structure was set
+ */
+bool QHexView::setStructure(const QString &declaration, address_t address, int64_t count, QString *error) {
+
+	QHexStructure structure;
+	if (!structure.parse(declaration, error)) {
+		return false;
+	}
+
+	structure_ = std::make_unique<QHexStructureOverlay>(std::move(structure), static_cast<int64_t>(address - addressOffset_), count);
+	structureTimer_->start(0);
+	viewport()->update();
+	return true;
+}
+
+/**
+ * @brief QHexView::clearStructure
+ */
+void QHexView::clearStructure() {
+	structure_ = nullptr;
+	structureTimer_->stop();
+	viewport()->update();
+}
@@ -16,16 +16,28 @@ The license chosen is at the discretion of the user of this software.
 #ifndef QHEXVIEW_H_
 #define QHEXVIEW_H_
 
+#include "qhexcodec.h"
+#include "qhexhighlights.h"
+#include "qhexrangereader.h"
+#include "qhexrepeatindex.h"
+#include "qhexselection.h"
+#include "qhexselectionmodel.h"
+#include "qhexstructure.h"
 #include <QAbstractScrollArea>
 #include <QBuffer>
+#include <QHash>
+#include <QPen>
 #include <cstdint>
 #include <memory>
 
 class QByteArray;
+class QHexPageCache;
+class QHexRegionDevice;
 class QIODevice;
 class QMenu;
 class QString;
 class QTextStream;
+class QTimer;
 
 class QHexView : public QAbstractScrollArea {
 	Q_OBJECT
@@ -36,9 +48,81 @@ public:
 		Address64 = 8
 	};
 
+	// bytes are put into one of these classes by value, each class can be
+	// given its own color, see setColorByteClasses
+	enum ByteClass {
+		NullByte,       // 0x00
+		WhitespaceByte, // space, \t, \n, \v, \f and \r
+		PrintableByte,  // the rest of printable ascii
+		ControlByte,    // the rest of 0x01 - 0x1f and 0x7f
+		HighBitByte,    // 0x80 - 0xfe
+		FullByte,       // 0xff
+		ByteClassCount
+	};
+
+	enum ByteOrder {
+		LittleEndian,
+		BigEndian
+	};
+
+	enum DataFormat {
+		Hexadecimal,
+		Binary,
+		Octal,
+		UnsignedDecimal,
+		SignedDecimal,
+		FloatingPoint // only applies to 4 and 8 byte words, others are shown as hex
+	};
+
+	enum HeatmapMode {
+		NoHeatmap,
+		HeatmapBackground, // hex cells are filled with a color picked by their value
+		HeatmapText        // hex cells are drawn in a color picked by their value
+	};
+
+	enum PasteMode {
+		PasteOverwrite, // pasted bytes replace the ones at the start of the selection
+		PasteInsert     // pasted bytes are inserted before the start of the selection
+	};
+
+	enum RowWidthMode {
+		FixedRowWidth,        // rows are always rowWidth() words wide
+		FitRowWidth,          // rows are as many words wide as fit in the viewport
+		FitRowWidthPowerOfTwo // like FitRowWidth, rounded down to a power of two
+	};
+
+	enum TextEncoding {
+		Latin1,
+		Iso8859_2,
+		Iso8859_5,
+		Iso8859_15,
+		Windows1251,
+		Windows1252,
+		Ebcdic037,
+		Utf8,
+		Utf16LE,
+		Utf16BE
+	};
+
 public:
 	using address_t = uint64_t;
 
+	static constexpr int MaxBytesPerRow = 256;
+
+private:
+	using RowFormatter = void (*)(const uint8_t *data, int count, char *out);
+
+	class AddressFormatter;
+
+	struct AddressFormat {
+		address_t base = 0;   // relative addresses are shown as an offset from this
+		int digits     = 16;  // zero padded
+		int group      = 8;   // digits between separators, 0 for none
+		char separator = ':';
+		bool decimal   = false;
+		bool relative  = false;
+	};
+
 private:
 	class CommentServerBase {
 	public:
@@ -86,15 +170,27 @@ public Q_SLOTS:
 	void repaint();
 	void setAddressColor(const QColor &color);
 	void setAlternateWordColor(const QColor &color);
+	void setByteClassColor(ByteClass byteClass, const QColor &color);
+	void setByteOrder(ByteOrder byteOrder);
+	void setCollapseRepeatedRows(bool);
+	void setColorByteClasses(bool);
+	void setDataFormat(DataFormat dataFormat);
+	void setDecompressGzip(bool);
 	void setColdZoneColor(const QColor &color);
 	void setFont(const QFont &font);
+	void setHeatmapColors(const QColor &low, const QColor &high);
+	void setHeatmapMode(HeatmapMode mode);
 	void setNonPrintableTextColor(const QColor &color);
 	void setRowWidth(int);
+	void setRowWidthMode(RowWidthMode mode);
 	void setShowAddress(bool);
 	void setShowAddressSeparator(bool value);
 	void setShowAsciiDump(bool);
+	void setShowDecimalAddresses(bool);
+	void setShowRelativeAddresses(bool);
 	void setShowComments(bool);
 	void setShowHexDump(bool);
+	void setTextEncoding(TextEncoding encoding);
 	void setUserConfigRowWidth(bool);
 	void setUserConfigWordWidth(bool);
 	void setWordWidth(int);
@@ -102,50 +198,88 @@ public Q_SLOTS:
 
 public:
 	address_t addressOffset() const;
+	address_t relativeAddressBase() const;
 	address_t firstVisibleAddress() const;
 	address_t selectedBytesAddress() const;
 	AddressSize addressSize() const;
+	ByteOrder byteOrder() const;
+	DataFormat dataFormat() const;
+	bool collapseRepeatedRows() const;
+	bool colorByteClasses() const;
+	bool decompressGzip() const;
 	bool hasSelectedText() const;
 	bool hideLeadingAddressZeros() const;
+	bool isEditable() const;
 	bool showAddress() const;
 	bool showAsciiDump() const;
 	bool showComments() const;
+	bool showDecimalAddresses() const;
+	bool showRelativeAddresses() const;
 	bool showHexDump() const;
 	bool userConfigRowWidth() const;
 	bool userConfigWordWidth() const;
+	HeatmapMode heatmapMode() const;
+	int addressGroupSize() const;
 	int rowWidth() const;
+	RowWidthMode rowWidthMode() const;
 	int wordWidth() const;
 	QByteArray allBytes() const;
 	QByteArray selectedBytes() const;
+	QHexRangeReader allBytesReader(int chunk_size = QHexRangeReader::DefaultChunkSize) const;
+	QHexRangeReader selectedBytesReader(int chunk_size = QHexRangeReader::DefaultChunkSize) const;
+	bool saveAll(const QString &filename, QString *error = nullptr) const;
+	bool saveSelection(const QString &filename, QString *error = nullptr) const;
+	bool exportSelection(QHexCodec::ExportFormat format, QIODevice *out, QString *error = nullptr) const;
+	void copySelectionAs(QHexCodec::ExportFormat format);
+	bool pasteHex(const QString &text, PasteMode mode, QString *error = nullptr);
 	QColor addressColor() const;
 	QColor alternateWordColor() const;
+	QColor byteClassColor(ByteClass byteClass) const;
 	QColor coldZoneColor() const;
+	QColor heatmapHighColor() const;
+	QColor heatmapLowColor() const;
 	QColor nonPrintableTextColor() const;
 	QIODevice *data() const { return data_; }
+	const QHexSelection &selection() const { return selectionModel_->selection(); }
+	QHexSelectionModel *selectionModel() const { return selectionModel_; }
+	void setSelectionModel(QHexSelectionModel *model);
 	QMenu *createStandardContextMenu();
+	TextEncoding textEncoding() const;
 	uint64_t selectedBytesSize() const;
+	int addHighlight(address_t start, address_t end, const QColor &color, const QString &label = QString());
+	int addHighlights(std::vector<QHexHighlights::Highlight> highlights);
+	void clearHighlights();
+	void removeHighlight(int id);
+	bool setStructure(const QString &declaration, address_t address, int64_t count = 1, QString *error = nullptr);
+	void clearStructure();
 	void scrollTo(address_t offset);
+	void setAddressGroupSize(int digits);
 	void setAddressOffset(address_t offset);
 	void setAddressSize(AddressSize address_size);
 	void setColdZoneEnd(address_t offset);
+	void setRelativeAddressBase(address_t base);
 	void setData(QIODevice *d);
+	std::shared_ptr<QHexPageCache> pageCache() const;
 
 public Q_SLOTS:
 	void clear();
 	void deselect();
 	void mnuAddrCopy();
 	void mnuCopy();
+	void mnuPasteInsert();
+	void mnuPasteOverwrite();
+	void mnuSaveSelection();
 	void mnuSetFont();
 	void selectAll();
 
 private:
 	bool isInViewableArea(int64_t index) const;
-	bool isSelected(int64_t index) const;
 	int addressLength() const;
 	int asciiDumpLeft() const;
 	int bytesPerRow() const;
 	int charsPerWord() const;
 	int commentLeft() const;
+	int fittedRowWidth() const;
 	int hexDumpLeft() const;
 	int line1() const;
 	int line2() const;
@@ -154,27 +288,57 @@ private:
 	int64_t normalizedOffset() const;
 	int64_t pixelToWord(int x, int y) const;
 	QString formatAddress(address_t address) const;
-	QString formatBytes(const QByteArray &row_data, int index) const;
-	void drawAsciiDump(QPainter &painter, int64_t offset, int row, int64_t size, const QByteArray &row_data) const;
+	const QString &glyph(char32_t ch) const;
+	const QString &latin1Text(const char *text, int length) const;
+	const QString &latin1Words(const char *text, int count, int chars_per_word) const;
+	const QPen &pen(const QColor &color) const;
+	bool highlightRow(int64_t offset, int size, QRgb *out) const;
+	bool holeRow(int64_t offset, int size, bool *out) const;
+	bool hasComments() const;
+	const QString &rowComment(int64_t offset) const;
+	const QByteArray &readRow(int64_t offset, int size) const;
+	int formatRow(const QByteArray &row_data, char *buffer) const;
+	void drawAsciiDump(QPainter &painter, int64_t offset, int row, int64_t size, const QByteArray &row_data, const QRgb *highlights) const;
 	void drawAsciiDumpToBuffer(QTextStream &stream, int64_t offset, int64_t size, const QByteArray &row_data) const;
 	void drawComments(QPainter &painter, int64_t offset, int row, int64_t size) const;
 	void drawCommentsToBuffer(QTextStream &stream, int64_t offset, int64_t size) const;
-	void drawHexDump(QPainter &painter, int64_t offset, int row, int64_t size, int *word_count, const QByteArray &row_data) const;
+	void drawHexDump(QPainter &painter, int64_t offset, int row, int64_t size, int *word_count, const QByteArray &row_data, const QRgb *highlights) const;
 	void drawHexDumpToBuffer(QTextStream &stream, int64_t offset, int64_t size, const QByteArray &row_data) const;
 	void ensureVisible(int64_t index);
+	void updateAddressFormat();
+	void updateLayout();
+	void updateRowFormatter();
 	void updateScrollbars();
+	void updateSelection();
+	void selectionModelChanged();
 	void updateToolTip();
+	void updateRepeatIndex();
+	void scanRepeatedRows();
+	void resetStructure();
+	void scanStructure();
+	void dataSizeChanged();
+	void drawRepeatMarker(QPainter &painter, int row, int64_t repeats) const;
 
 private:
 	AddressSize addressSize_      = Address64;
+	ByteOrder byteOrder_          = LittleEndian; // byte order used to display multi-byte words
+	DataFormat dataFormat_        = Hexadecimal;  // how words are rendered in the data column
+	TextEncoding textEncoding_    = Latin1;       // how bytes are decoded for the text column
+	RowWidthMode rowWidthMode_    = FixedRowWidth;
+	HeatmapMode heatmapMode_      = NoHeatmap;
 	QColor addressColor_          = Qt::red; // color of the address in display
 	QColor alternateWordColor_    = Qt::blue;
 	QColor coldZoneColor_         = Qt::gray;
 	QColor nonPrintableTextColor_ = Qt::red;
+	QColor heatmapLowColor_       = QColor(0xc8, 0xdc, 0xff); // color of 0x00 in the heatmap
+	QColor heatmapHighColor_      = QColor(0xff, 0x98, 0x78); // color of 0xff in the heatmap
+	QColor byteClassColors_[ByteClassCount] = {Qt::darkGray, Qt::darkCyan, QColor(), Qt::darkMagenta, QColor(), Qt::darkRed}; // an invalid color leaves the class uncolored
 	QIODevice *data_              = nullptr;
+	RowFormatter rowFormatter_    = nullptr; // formats a row of words, selected by updateRowFormatter
 	address_t addressOffset_      = 0; // this is the offset that our base address is relative to
 	address_t coldZoneEnd_        = 0; // base_address - cold_zone_end_ will be displayed as gray
 	address_t origin_             = 0;
+	address_t relativeAddressBase_ = 0;
 	bool showAddressSeparator_    = true; // should we show ':' character in address to separate high/low portions
 	bool showAddress_             = true; // should we show the address display?
 	bool showAscii_               = true; // should we show the ascii display?
@@ -186,15 +350,59 @@ private:
 	bool userCanSetRowWidth_      = true;
 	bool userCanSetWordWidth_     = true;
 	bool hideLeadingAddressZeros_ = false;
+	bool colorByteClasses_        = false;
+	bool decimalAddresses_        = false;
+	bool relativeAddresses_       = false;
+	bool collapseRepeatedRows_    = false; // show runs of identical rows as one row and a marker
+	bool decompressGzip_          = false; // show gzip files decompressed, see setData
 	char unprintableChar_         = '.';
+	int addressGroupSize_         = 0;  // digits between address separators, 0 for the default
 	int fontHeight_               = 0;  // height of a character in this font
 	int fontWidth_                = 0;  // width of a character in this font
 	int rowWidth_                 = 16; // amount of 'words' per row
 	int wordWidth_                = 1;  // size of a 'word' in bytes
 	int64_t selectionEnd_         = -1; // index of last selected word (or -1)
 	int64_t selectionStart_       = -1; // index of first selected word (or -1)
+	bool columnSelection_         = false; // selectionStart_ and selectionEnd_ are the corners of a block of columns
 	std::unique_ptr<CommentServerBase> commentServer_;
 	std::unique_ptr<QBuffer> internalBuffer_;
+	std::shared_ptr<QIODevice> wrappedData_; // reads the data given to setData when it is gzip compressed or a sparse file, shared with other views of it
+	std::shared_ptr<QHexPageCache> pageCache_; // everything drawn is read through this, see repaint
+	int64_t knownSize_ = 0;                    // the size of the data when it was last looked at, see dataSizeChanged
+	QHexRegionDevice *regionData_ = nullptr;   // data_ when it has holes, which are drawn blank
+	QHexRepeatIndex repeatIndex_; // runs of identical rows, only kept up to date when collapsing them
+	QTimer *repeatIndexTimer_ = nullptr;
+	QHexHighlights highlights_;
+	std::unique_ptr<QHexStructureOverlay> structure_; // fields shown as comments and highlights, see setStructure
+	QTimer *structureTimer_ = nullptr;
+	QHexSelectionModel *selectionModel_ = nullptr; // everything which is selected, possibly shared with other views
+	bool changingSelection_             = false;   // the selection is being changed by this view, see updateSelection
+	QHexSelection previousSelection_; // what was selected before the range being selected now was started
+	QRgb heatmapColors_[256];     // heatmap gradient by byte value, see setHeatmapColors
+	QRgb heatmapTextColors_[256]; // darker version of the above for HeatmapText
+	mutable QHash<uint, QString> glyphCache_; // strings for every character drawn in the text column so far
+
+	// buffers which are reused by every paint and copy, so that drawing a row
+	// builds no strings or pens of its own once they have grown to fit a row
+	// and every character and color drawn has been seen before. Comments from
+	// a comment server are whatever it returns
+	mutable struct Scratch {
+		QByteArray row;         // bytes of the row being drawn, see readRow
+		QString text;           // text of the cell being drawn, see latin1Text
+		QString comment;        // comment of the row being drawn, see rowComment
+		QString marker;         // the repeat marker being drawn, see drawRepeatMarker
+		QString markerFormat;   // the translated text of the marker
+		QHash<QRgb, QPen> pens; // every pen used so far, see pen
+	} scratch_;
+
+	// column geometry, recalculated by updateLayout whenever it may change
+	struct Layout {
+		AddressFormat address;
+		int charsPerWord = 2;
+		int line1        = 0;
+		int line2        = 0;
+		int line3        = 0;
+	} layout_;
 
 	enum class Highlighting {
 		None,